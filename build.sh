@@ -13,14 +13,22 @@ check_if_exists() {
 
 PKG=./src/flexrml
 
+# Output compression, gzip through zlib and zstd if libzstd is installed
+COMPRESSION_LIBS="-lz"
+if echo '#include <zstd.h>' | g++ -E -x c++ - >/dev/null 2>&1; then
+  COMPRESSION_LIBS="$COMPRESSION_LIBS -DFLEXRML_ZSTD -lzstd"
+fi
+
 echo "Cleaning old shared libraries..."
 rm -f \
   $PKG/frontend/libnormalizer.so \
   $PKG/frontend/libraconverter.so \
   $PKG/frontend/librdfparser.so \
   $PKG/frontend/libfunctionexecutor.so \
+  $PKG/backend/libexecutorruntime.so \
   $PKG/backend/libexecutor.so \
   $PKG/backend/librapartitioner.so \
+  $PKG/backend/libplanoptimizer.so \
   $PKG/backend/libthreadexecutor.so
 
 echo "Building rml parser ..."
@@ -66,15 +74,47 @@ g++ -std=c++20 -shared -fPIC \
 check_if_exists $PKG/backend/librapartitioner.so
 echo ""
 
+echo "Building physical plan optimizer ..."
+g++ -std=c++20 -shared -fPIC \
+  -o $PKG/backend/libplanoptimizer.so \
+  $PKG/backend/optimizations/physical_plan_optimizer.cpp \
+  -O3
+check_if_exists $PKG/backend/libplanoptimizer.so
+echo ""
+
+echo "Building executor runtime ..."
+# The CPU budget, helper pool and output writers are shared by both executor libraries
+g++ -std=c++20 -shared -fPIC \
+  -o $PKG/backend/libexecutorruntime.so \
+  $PKG/backend/executor/resource_manager.cpp \
+  $PKG/backend/executor/output_writer.cpp \
+  $PKG/backend/executor/external_sort.cpp \
+  $PKG/backend/executor/hdt_output.cpp \
+  $PKG/backend/executor/turtle_output.cpp \
+  $PKG/backend/executor/ntriples.cpp \
+  $PKG/backend/executor/xxhash.c \
+  $PKG/backend/executor/utils.cpp \
+  $PKG/backend/executor/triple_collector.cpp \
+  -I$PKG/backend/executor \
+  $COMPRESSION_LIBS \
+  -O3
+check_if_exists $PKG/backend/libexecutorruntime.so
+echo ""
+
 echo "Building executor ..."
 g++ -std=c++20 -shared -fPIC \
   -o $PKG/backend/libexecutor.so \
   $PKG/backend/executor/executor.cpp \
-  $PKG/backend/executor/xxhash.c \
   $PKG/backend/executor/simple_executor.cpp \
-  $PKG/backend/executor/utils.cpp \
   $PKG/backend/executor/complex_executor.cpp \
+  $PKG/backend/executor/join_index.cpp \
+  $PKG/backend/executor/scheduler.cpp \
+  $PKG/backend/executor/cost_model.cpp \
+  $PKG/backend/executor/sharded_output.cpp \
+  $PKG/backend/executor/result_store.cpp \
   -I$PKG/backend/executor \
+  -L$PKG/backend -lexecutorruntime -Wl,-rpath,'$ORIGIN' \
+  $COMPRESSION_LIBS \
   -O3
 check_if_exists $PKG/backend/libexecutor.so
 echo ""
@@ -83,9 +123,10 @@ echo "Building threaded executor ..."
 g++ -std=c++20 -shared -fPIC \
   -o $PKG/backend/libthreadexecutor.so \
   $PKG/backend/executor/simple_executor_threaded.cpp \
-  $PKG/backend/executor/xxhash.c \
-  $PKG/backend/executor/utils.cpp \
+  $PKG/backend/executor/adaptive_chunking.cpp \
   -I$PKG/backend/executor \
+  -L$PKG/backend -lexecutorruntime -Wl,-rpath,'$ORIGIN' \
+  $COMPRESSION_LIBS \
   -O3
 check_if_exists $PKG/backend/libthreadexecutor.so
 echo ""
\ No newline at end of file
@@ -1,5 +1,6 @@
 import ctypes
 import os
+import stat
 import sys
 from collections import defaultdict
 import time
@@ -27,7 +28,31 @@ class Configuration:
         self.threading_enabled = "true"
         self.materialize_constants = "true"
         self.heuristic_ordering = "true"
+        self.join_elimination = "true"
+        self.referential_integrity = "false"
+        self.join_index_dir = ""
+        self.threads = "0"
+        self.cpu_affinity = ""
+        self.numa_node = ""
+        self.sharded_output = "false"
+        self.concatenate_shards = "false"
+        self.output_format = "nt"
+        self.turtle_prefixes = ""
+        self.compression = ""
+        self.compression_level = "0"
+        self.output_cache = "keep"
+        self.preallocate_output = "false"
+        self.sorted_output = "false"
+        self.sort_dedup = "false"
+        self.sort_memory = ""
+        self.sort_directory = ""
+        self.rotate_bytes = ""
+        self.rotate_triples = ""
+        self.route_graphs = "false"
+        self.graph_sinks = ""
         self.keep_in_memory = "false"
+        self.result_dictionary = "false"
+        self.result_iterator = "false"
         self.return_triple = False
         self.data = {}
 
@@ -35,6 +60,7 @@ class Configuration:
         self.bn_number = 58932
         self.iterators = []
         self.lib_ra_partitioner = self.load_ra_partitioner()
+        self.lib_plan_optimizer = self.load_plan_optimizer()
         self.lib_plan_executor = self.load_plan_executor()
         self.lib_threaded_plan_executor = self.load_threaded_plan_executor()
 
@@ -51,18 +77,38 @@ class Configuration:
         lib = self._load_cdll("librapartitioner.so")
         lib.ra_partitioner.argtypes = [ctypes.c_char_p]
         lib.ra_partitioner.restype = ctypes.c_char_p
+        lib.template_namespaces.argtypes = [ctypes.c_char_p]
+        lib.template_namespaces.restype = ctypes.c_char_p
         return lib
     
+    def load_plan_optimizer(self):
+        lib = self._load_cdll("libplanoptimizer.so")
+        lib.optimize_physical_plans.argtypes = [ctypes.c_char_p]
+        lib.optimize_physical_plans.restype = ctypes.c_char_p
+        return lib
+
     def load_plan_executor(self):
         lib = self._load_cdll("libexecutor.so")
-        lib.execute_physical_plans.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
+        lib.execute_physical_plans.argtypes = [ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p, ctypes.c_char_p]
         lib.execute_physical_plans.restype = ctypes.c_char_p
+        lib.output_write_stats.argtypes = []
+        lib.output_write_stats.restype = ctypes.c_char_p
+        lib.result_segment_count.argtypes = []
+        lib.result_segment_count.restype = ctypes.c_size_t
+        lib.result_segment.argtypes = [ctypes.c_size_t, ctypes.POINTER(ctypes.c_size_t)]
+        lib.result_segment.restype = ctypes.c_void_p
+        lib.release_result_segment.argtypes = [ctypes.c_size_t]
+        lib.release_result_segment.restype = None
         return lib       
 
     def load_threaded_plan_executor(self):
         lib = self._load_cdll("libthreadexecutor.so")
-        lib.simple_threaded_mapping.argtypes = [ctypes.c_char_p]
+        lib.simple_threaded_mapping.argtypes = [ctypes.c_char_p, ctypes.c_char_p]
         lib.simple_threaded_mapping.restype = ctypes.c_int
+        lib.threaded_run_stats.argtypes = []
+        lib.threaded_run_stats.restype = ctypes.c_char_p
+        lib.output_write_stats.argtypes = []
+        lib.output_write_stats.restype = ctypes.c_char_p
         return lib
 
 ####################################################################################################################
@@ -155,14 +201,19 @@ def parse_ra(ra_expressions):
                     sys.exit()
                 join_node = ""
             else:
-                join_arguments = ra_expression.split("pi[")[2].split("bowtie")[1].split("[")[1].split("]")[0].replace("=", "===").strip()
+                join_arguments = ra_expression.split("pi[")[2].split("bowtie")[1].split("[")[1].split("]")[0].strip()
 
-                # Rename as parent and child
-                join_arg_left = join_arguments.split("===")[0].replace(source1, "parent")
-                join_arg_right = join_arguments.split("===")[1].replace(source2, "child")
-                join_arguments = f"{join_arg_left}==={join_arg_right}"
+                # Composite keys: one A===B pair per join condition
+                join_conditions = []
+                for join_condition in join_arguments.split(","):
+                    join_condition = join_condition.replace("=", "===").strip()
 
-                join_node = {"type": "equi-join", "arguments": join_arguments}
+                    # Rename as parent and child
+                    join_arg_left = join_condition.split("===")[0].replace(source1, "parent")
+                    join_arg_right = join_condition.split("===")[1].replace(source2, "child")
+                    join_conditions.append(f"{join_arg_left}==={join_arg_right}")
+
+                join_node = {"type": "equi-join", "arguments": join_conditions}
 
             create_count = ra_expression.split("pi[")[1].count("create(")
 
@@ -233,13 +284,13 @@ def create_physical_plans(ra_expressions, config):
             if len(ra_expression[3]) == 4:
                 plan = [["seq_scan", ra_expression[0]["in_relation"], ra_expression[0]["arguments"], ra_expression[0]["name"]],
                         ["seq_scan", ra_expression[1]["in_relation"], ra_expression[1]["arguments"], ra_expression[1]["name"]],
-                        ["hash_join", ra_expression[2]["arguments"]],
+                        ["hash_join", *ra_expression[2]["arguments"]],
                         ["format", ra_expression[3]["s_content"], ra_expression[3]["p_content"], ra_expression[3]["o_content"]],
                         [config.output_file_path], [config.base_uri], [config.continue_on_error]]
             else:
                 plan = [["seq_scan", ra_expression[0]["in_relation"], ra_expression[0]["arguments"], ra_expression[0]["name"]],
                         ["seq_scan", ra_expression[1]["in_relation"], ra_expression[1]["arguments"], ra_expression[1]["name"]],
-                        ["hash_join", ra_expression[2]["arguments"]],
+                        ["hash_join", *ra_expression[2]["arguments"]],
                         ["format", ra_expression[3]["s_content"], ra_expression[3]["p_content"], ra_expression[3]["o_content"], ra_expression[3]["g_content"]],
                         [config.output_file_path], [config.base_uri], [config.continue_on_error]]
             physical_plans.append(plan)
@@ -249,53 +300,99 @@ def create_physical_plans(ra_expressions, config):
     
     return physical_plans
 ##########################################################################################
-# Remove self joins
-def remove_self_join(physical_plans):
+# Join elimination
+def get_template_references(content):
+    """Returns the attributes referenced by a term ("term_map===term_map_type===...")."""
+    if content[1] == "template":
+        references = []
+        for part in content[0].split("{")[1:]:
+            references.append(part.split("}")[0])
+        return references
+    elif content[1] == "reference":
+        return [content[0]]
+    return []
+
+def strip_relation_prefix(content_str, relation):
+    """Removes the relation prefix of all attributes referenced in a term."""
+    content = content_str.split("===")
+    if content[1] == "template":
+        content[0] = content[0].replace("{" + relation + "_", "{")
+    elif content[1] == "reference" and content[0].startswith(relation + "_"):
+        content[0] = content[0][len(relation) + 1:]
+    return "===".join(content)
+
+def eliminate_joins(physical_plans, config):
+    """
+    Removes joins whose object is derivable from the join key alone, e.g.
+    subject ex:stop/{stop_id} of the parent joined on child.stop_id = parent.stop_id.
+    The object is then generated from the join columns of the subject side.
+    If referential integrity is guaranteed the join becomes a simple scan, otherwise
+    a semi join keeps only rows whose key exists on the other side.
+    """
     new_physical_plans = []
-    
+
     for plan in physical_plans:
         # must be join
-        if len(plan) != 7:
+        if len(plan) != 7 or plan[2][0] != "hash_join":
             new_physical_plans.append(plan)
             continue
 
-        # check if both have the same source
-        if plan[0][1] != plan[1][1]:
+        # Join conditions: parent_A===child_B
+        join_map = {}
+        for join_condition in plan[2][1:]:
+            join_arg_left, join_arg_right = join_condition.split("===")
+            join_map[join_arg_right] = join_arg_left
+
+        # Other side may only project the join key, so each key matches at most one row
+        if any(f"child_{attr}" not in join_map for attr in plan[1][2].split("===")):
             new_physical_plans.append(plan)
             continue
 
-        # Extract projected arguments
-        args_1 = plan[0][2].split("===")
-        args_2 = plan[1][2].split("===")
-
-        combined_args = args_1 + args_2
-        print(combined_args)
-        print("====")
+        o_content = plan[3][3].split("===")
+        if o_content[1] == "template":
+            references = get_template_references(o_content)
+            if any(reference not in join_map for reference in references):
+                new_physical_plans.append(plan)
+                continue
+            for reference in references:
+                o_content[0] = o_content[0].replace("{" + reference + "}", "{" + join_map[reference] + "}")
+        elif o_content[1] not in ("constant", "preformatted"):
+            new_physical_plans.append(plan)
+            continue
 
-        new_scan = ['seq_scan', plan[0][1], ("===").join(combined_args), plan[0][1]]
+        new_format = ["format", plan[3][1], plan[3][2], "===".join(o_content), *plan[3][4:]]
 
-        # Handle format 
-        subject = plan[3][1]
-        new_subject = subject.replace(f"{plan[0][1]}_", "")
-        prediacte = plan[3][2]
-        new_prediacte = prediacte.replace(f"{plan[0][1]}_", "")
-        object = plan[3][3]
-        new_object = object.replace(f"{plan[0][1]}_", "")
+        if config.referential_integrity == "true":
+            # Plain scan of the subject side
+            new_format = ["format"] + [strip_relation_prefix(content, "parent") for content in new_format[1:]]
+            new_scan = ["seq_scan", plan[0][1], plan[0][2]]
+            new_plan = [new_scan, new_format, plan[4], plan[5], plan[6]]
+        else:
+            # Keep existence check
+            new_plan = [plan[0], plan[1], ["semi_join", *plan[2][1:]], new_format, plan[4], plan[5], plan[6]]
 
-        new_format = ["format", new_subject, new_prediacte, new_object]
+        new_physical_plans.append(new_plan)
 
-        if len(plan[3]) == 5:
-            graph = plan[3][4]
-            new_graph = graph.replace(f"{plan[0][1]}_", "")
-            new_format.append(new_graph)
+    return new_physical_plans
 
+##########################################################################################
+def optimize_physical_plans(physical_plans, config):
+    """
+    Native rewrites of the physical plans, e.g. self joins over a single source
+    are replaced by a scan or executed with one shared scan.
+    """
+    if len(physical_plans) == 0:
+        return physical_plans
 
-        new_plan = [new_scan, new_format, plan[4], plan[5], plan[6]]
-        new_physical_plans.append(new_plan)
+    plans = "PxPwPePrP".join(phys_plan_to_str(plan) for plan in physical_plans)
+    lib = config.lib_plan_optimizer
+    result_str = lib.optimize_physical_plans(plans.encode()).decode()
 
+    new_physical_plans = []
+    for plan_str in result_str.split("PxPwPePrP"):
+        new_physical_plans.append([line.split("|||") for line in plan_str.split("\n")[:-1]])
     return new_physical_plans
 
-
 ##########################################################################################
 def constant_folding(ra_expressions):
     for ra_expression in ra_expressions:
@@ -362,38 +459,112 @@ def standard_threading(plan_partitions, config, start_time, in_memory_data):
         plans += "TTTtttTTTtttTTT"
     plans = plans.strip().encode()
     lib = config.lib_plan_executor
-    output = lib.execute_physical_plans(plans, config.threading_enabled.encode(), config.continue_on_error.encode(), config.output_file_path.encode(), config.keep_in_memory.encode(), in_memory_data.encode())
+    output = lib.execute_physical_plans(plans, config.threading_enabled.encode(), config.continue_on_error.encode(), config.output_file_path.encode(), config.keep_in_memory.encode(), in_memory_data.encode(), executor_options(config).encode())
     output = output.decode()
     generated_triple = output.split("|||")[0]
-    triple_string = output.split("|||")[1]
     
     if config.show_output:
         print(f"Execution finished.\nGenerated: {generated_triple} triple in {time.time()-start_time:.3f} seconds.")
-
-    if config.keep_in_memory:
-        if config.return_triple:
-            return triple_string.strip()
+        print_write_stats(lib)
+
+    # The triples kept in memory are read from the result store segment by segment
+    if config.keep_in_memory == "true":
+        if config.return_triple and config.result_iterator == "true":
+            return stored_triples(lib)
+        elif config.return_triple:
+            return "".join(stored_segments(lib)).strip()
         else:
-            print(triple_string.strip())
+            for segment in stored_segments(lib):
+                sys.stdout.write(segment)
+            sys.stdout.flush()
+
+
+def stored_segments(lib):
+    """Segments of the result store of the last execution as N-Triples, each segment is
+    released by the executor once it is read."""
+    size = ctypes.c_size_t()
+    for index in range(lib.result_segment_count()):
+        data = lib.result_segment(index, ctypes.byref(size))
+        segment = ctypes.string_at(data, size.value).decode() if size.value else ""
+        lib.release_result_segment(index)
+        yield segment
+
+
+def stored_triples(lib):
+    """Lines of the result store, read lazily. The store is replaced by the next execution."""
+    for segment in stored_segments(lib):
+        yield from segment.splitlines()
+
+
+def executor_options(config):
+    """Options of the native executor as key===value|||key===value."""
+    options = {"join_index_dir": config.join_index_dir,
+               "heuristic_ordering": config.heuristic_ordering,
+               "threads": config.threads,
+               "cpu_affinity": config.cpu_affinity,
+               "numa_node": config.numa_node,
+               "sharded_output": config.sharded_output,
+               "concatenate_shards": config.concatenate_shards,
+               "output_format": config.output_format,
+               "turtle_prefixes": config.turtle_prefixes,
+               "compression": config.compression,
+               "compression_level": config.compression_level,
+               "output_cache": config.output_cache,
+               "preallocate": config.preallocate_output,
+               "result_dictionary": config.result_dictionary,
+               "sorted_output": config.sorted_output,
+               "sort_dedup": config.sort_dedup,
+               "sort_memory": config.sort_memory,
+               "sort_directory": config.sort_directory,
+               "rotate_bytes": config.rotate_bytes,
+               "rotate_triples": config.rotate_triples,
+               "route_graphs": config.route_graphs,
+               "graph_sinks": config.graph_sinks}
+    return "|||".join(f"{key}==={value}" for key, value in options.items())
+
+
+def is_stream_output(path):
+    """Output streamed to stdout ("-"), a named pipe or a Unix domain socket, never truncated."""
+    if path == "-" or path.startswith("unix:"):
+        return True
+    try:
+        mode = os.stat(path).st_mode
+    except OSError:
+        return False
+    return stat.S_ISFIFO(mode) or stat.S_ISSOCK(mode)
 
 
 def alternative_threading(plan_partitions, config, start_time):
-    with open(config.output_file_path, 'w') as file:
-        pass
-    generated_triple = 0
-    for partition in plan_partitions:
-        plans = ""
-        for plan in partition:
-            plans += phys_plan_to_str(plan).strip() + "PxPwPePrP"
-        if "hash_join" in plans:
-            standard_threading(plan_partitions, config, start_time)
-        else:
-            if config.threading_enabled == "false":
-                standard_threading(plan_partitions, config, start_time)
-            else:
-                lib = config.lib_threaded_plan_executor
-                generated_triple += lib.simple_threaded_mapping(plans.encode())
-                print(f"Execution threading finished.\nGenerated: {generated_triple} triple in {time.time()-start_time:.3f} seconds.")
+    # Only a single partition of simple plans runs in the threaded pipeline, shards are written per partition
+    # and rotated and graph files are listed in the manifests of the standard executor
+    partition = next(iter(plan_partitions))
+    rotate_output = config.rotate_bytes not in ("", "0") or config.rotate_triples not in ("", "0")
+    if config.threading_enabled == "false" or config.continue_on_error == "true" or config.sharded_output == "true" or rotate_output or config.route_graphs == "true" or any(len(plan) == 7 for plan in partition):
+        standard_threading(plan_partitions, config, start_time, "")
+        return
+
+    if not is_stream_output(config.output_file_path):
+        with open(config.output_file_path, 'w') as file:
+            pass
+    plans = ""
+    for plan in partition:
+        plans += phys_plan_to_str(plan).strip() + "PxPwPePrP"
+    lib = config.lib_threaded_plan_executor
+    generated_triple = lib.simple_threaded_mapping(plans.encode(), executor_options(config).encode())
+    if config.show_output:
+        print(f"Execution threading finished.\nGenerated: {generated_triple} triple in {time.time()-start_time:.3f} seconds.")
+        stats = dict(entry.split("===") for entry in lib.threaded_run_stats().decode().split("|||"))
+        print(f"Chunks: {stats['chunks']} of {stats['chunk_rows']} rows, queue depth {stats['queue_depth']}, "
+              f"{stats['starved_chunks']} starved, {stats['blocked_chunks']} held back.")
+        print_write_stats(lib)
+
+
+def print_write_stats(lib):
+    """Prints bytes and write bandwidth of the output files of the last execution."""
+    for line in lib.output_write_stats().decode().splitlines():
+        stats = dict(entry.split("===") for entry in line.split("|||"))
+        print(f"Output: {stats['path']}, {stats['triples']} triples, {float(stats['megabytes']):.1f} MB written in {float(stats['seconds']):.3f} seconds "
+              f"({float(stats['bandwidth']):.1f} MB/s).")
 
 ##########################################################################################
 
@@ -566,6 +737,10 @@ def start_conversion(ra_expressions, config = None):
     sorted_data = sorted(data, key=lambda x: int(x[0]))
     partitioning_result = [item[1] for item in sorted_data]
 
+    # Turtle prefixes from the template invariants of the partitions
+    if config.output_format == "ttl":
+        config.turtle_prefixes = " ".join(lib.template_namespaces(tmp).decode().split())
+
     # Constant Folding: recognizing and evaluating constant expressions at compile time
     if config.materialize_constants == "true":
         ra_expressions = constant_folding(ra_expressions)
@@ -580,7 +755,10 @@ def start_conversion(ra_expressions, config = None):
     ### Physical plan optimization ###
     ##################################
 
-    #physical_plans = remove_self_join(physical_plans)
+    if config.join_elimination == "true":
+        physical_plans = eliminate_joins(physical_plans, config)
+
+    physical_plans = optimize_physical_plans(physical_plans, config)
 
     # Partition physical plans
     grouped_data = defaultdict(list)
@@ -589,44 +767,14 @@ def start_conversion(ra_expressions, config = None):
 
     plan_partitions = dict(grouped_data).values()
 
-    #####################################################
-
-    # Order plans
-    if config.heuristic_ordering == "true" and in_memory_data == "":
-        ordered_plans = {}
-        for plan_partition in plan_partitions:
-            total_file_size = 0
-
-            for plan in plan_partition:
-                # Simple mapping
-                if len(plan) == 5:
-                    path = plan[0][1]
-                    total_file_size += os.path.getsize(path)   
-                elif len(plan) == 7:  
-                    path1 = plan[0][1]
-                    total_file_size += os.path.getsize(path1)
-                    path2 = plan[1][1]
-                    total_file_size += os.path.getsize(path2)
-                else:
-                    print("Error ordering plans")
-                    sys.exit()
-
-            # Store multiple entries under the same file size
-            if total_file_size not in ordered_plans:
-                ordered_plans[total_file_size] = []
-            ordered_plans[total_file_size].append(plan_partition)
-
-        # Sort and flatten the list
-        sorted_dict_desc = dict(sorted(ordered_plans.items(), reverse=True))
-
-        plan_partitions = [partition for partitions in sorted_dict_desc.values() for partition in partitions]
+    # Partitions are ordered by the cost model of the executor (heuristic_ordering option)
 
     #####################################################
     #################
     ### Execution ###
     #################  
     try:
-        if len(plan_partitions) == 1 and config.keep_in_memory == False and in_memory_data == "":
+        if len(plan_partitions) == 1 and config.keep_in_memory == "false" and in_memory_data == "":
             alternative_threading(plan_partitions, config, start_time)       
         else:
             triple = standard_threading(plan_partitions, config, start_time, in_memory_data)
@@ -654,7 +802,16 @@ def konverter_from_file():
 ##########################################################################################
 
 def run_converter(ra_expressions: str, output_file_path: str, base_uri: str, continue_on_error: str, threading_enabled: str, 
-                  materialize_constants: str, heuristic_ordering: str, return_triple: bool, data= {}, iterators = []) -> None:
+                  materialize_constants: str, heuristic_ordering: str, return_triple: bool, data= {}, iterators = [],
+                  join_elimination: str = "true", referential_integrity: str = "false", join_index_dir: str = "",
+                  threads: str = "0", cpu_affinity: str = "", numa_node: str = "",
+                  sharded_output: str = "false", concatenate_shards: str = "false",
+                  compression: str = "", compression_level: str = "0", output_format: str = "nt",
+                  output_cache: str = "keep", preallocate_output: str = "false",
+                  sorted_output: str = "false", sort_dedup: str = "false", sort_memory: str = "",
+                  sort_directory: str = "", result_dictionary: str = "false", result_iterator: str = "false",
+                  rotate_bytes: str = "", rotate_triples: str = "", route_graphs: str = "false",
+                  graph_sinks: str = "") -> None:
     """
     Function imported in other projects using the konverter backend.
     Input: The ra_expression as string.
@@ -667,6 +824,29 @@ def run_converter(ra_expressions: str, output_file_path: str, base_uri: str, con
     config.threading_enabled = threading_enabled
     config.materialize_constants = materialize_constants
     config.heuristic_ordering = heuristic_ordering
+    config.join_elimination = join_elimination
+    config.referential_integrity = referential_integrity
+    config.join_index_dir = join_index_dir
+    config.threads = threads
+    config.cpu_affinity = cpu_affinity
+    config.numa_node = numa_node
+    config.sharded_output = sharded_output
+    config.concatenate_shards = concatenate_shards
+    config.output_format = output_format
+    config.compression = compression
+    config.compression_level = compression_level
+    config.output_cache = output_cache
+    config.preallocate_output = preallocate_output
+    config.sorted_output = sorted_output
+    config.sort_dedup = sort_dedup
+    config.sort_memory = sort_memory
+    config.sort_directory = sort_directory
+    config.result_dictionary = result_dictionary
+    config.result_iterator = result_iterator
+    config.rotate_bytes = rotate_bytes
+    config.rotate_triples = rotate_triples
+    config.route_graphs = route_graphs
+    config.graph_sinks = graph_sinks
     config.output_file_path = output_file_path
     config.iterators = iterators
     config.return_triple = return_triple
@@ -677,9 +857,12 @@ def run_converter(ra_expressions: str, output_file_path: str, base_uri: str, con
         data = {}
     config.data = data
 
-    # If no path is provided just print results at the end
+    # If no path is provided the triples are returned, or streamed to stdout by the writer
     if config.output_file_path == "":
-        config.keep_in_memory = "true"
+        if config.return_triple:
+            config.keep_in_memory = "true"
+        else:
+            config.output_file_path = "-"
 
     # Convert string to list
     ra_arr = ra_expressions.split("\n")
@@ -0,0 +1,137 @@
+#include "adaptive_chunking.h"
+
+#include <algorithm>
+#include <iomanip>
+#include <sstream>
+
+// Processing time a chunk should take
+constexpr double target_chunk_ns = 200000;
+// Bytes of a chunk and its triples that should stay in the cache of a core
+constexpr double cache_bytes = 256 * 1024;
+// Memory of a row while it is processed (fields, row map and triple) relative to its width in the file
+constexpr double row_expansion = 3;
+constexpr size_t min_chunk_rows = 16;
+constexpr size_t max_chunk_rows = 8192;
+constexpr size_t initial_chunk_rows = 256;
+// Chunks processed between two adaptations
+constexpr size_t adapt_window = 16;
+
+AdaptiveChunking::AdaptiveChunking(size_t producers, size_t max_depth)
+    : min_depth_(std::min<size_t>(max_depth, std::max<size_t>(2, producers))),
+      max_depth_(max_depth),
+      chunk_rows_(initial_chunk_rows),
+      queue_depth_(std::min<size_t>(max_depth, std::max<size_t>(4, 2 * producers))) {}
+
+void AdaptiveChunking::chunk_read(size_t rows, size_t bytes) {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    read_rows_ += rows;
+    read_bytes_ += bytes;
+    totals_.bytes_per_row = read_rows_ > 0 ? read_bytes_ / read_rows_ : 0;
+    update_chunk_rows();
+  }
+
+  // Hold the chunk back while the producers have enough work
+  bool blocked = false;
+  uint32_t in_flight = in_flight_.load(std::memory_order_acquire);
+  while (in_flight >= queue_depth_.load(std::memory_order_relaxed)) {
+    blocked = true;
+    in_flight_.wait(in_flight, std::memory_order_acquire);
+    in_flight = in_flight_.load(std::memory_order_acquire);
+  }
+  in_flight_.fetch_add(1, std::memory_order_acq_rel);
+
+  if (blocked) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    window_blocked_++;
+    totals_.blocked_chunks++;
+  }
+}
+
+void AdaptiveChunking::chunk_processed(size_t rows, std::chrono::nanoseconds elapsed, bool starved) {
+  in_flight_.fetch_sub(1, std::memory_order_acq_rel);
+  in_flight_.notify_one();
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  window_chunks_++;
+  window_rows_ += rows;
+  window_ns_ += static_cast<double>(elapsed.count());
+  totals_.chunks++;
+  if (starved) {
+    window_starved_++;
+    totals_.starved_chunks++;
+  }
+  // The first chunks only calibrate the time per row
+  if (window_chunks_ >= adapt_window || (ns_per_row_ == 0 && window_chunks_ >= 2)) {
+    adapt();
+  }
+}
+
+// Smallest of the cache bound and the time bound, mutex held.
+// Chunks grow at most twice as large at a time, so the time per row is known before they get large.
+void AdaptiveChunking::update_chunk_rows() {
+  double rows = 2.0 * chunk_rows_.load(std::memory_order_relaxed);
+  if (totals_.bytes_per_row > 0) {
+    rows = std::min(rows, cache_bytes / (totals_.bytes_per_row * row_expansion));
+  }
+  if (ns_per_row_ > 0) {
+    rows = std::min(rows, target_chunk_ns / ns_per_row_);
+  }
+  chunk_rows_.store(std::clamp(static_cast<size_t>(rows), min_chunk_rows, max_chunk_rows), std::memory_order_relaxed);
+}
+
+// Adapt to the measurements of the last window, mutex held
+void AdaptiveChunking::adapt() {
+  if (window_rows_ > 0) {
+    double window_ns_per_row = window_ns_ / window_rows_;
+    ns_per_row_ = ns_per_row_ == 0 ? window_ns_per_row : (ns_per_row_ + window_ns_per_row) / 2;
+  }
+  update_chunk_rows();
+
+  double starved = static_cast<double>(window_starved_) / window_chunks_;
+  double blocked = static_cast<double>(window_blocked_) / window_chunks_;
+  size_t depth = queue_depth_.load(std::memory_order_relaxed);
+  if (starved > 0.1 && blocked > 0.1) {
+    // The reader is fast enough on average, buffer its bursts
+    depth = std::min(max_depth_, depth * 2);
+  } else if (blocked > 0.5 && window_starved_ == 0) {
+    depth = std::max(min_depth_, depth - depth / 4);
+  }
+  queue_depth_.store(depth, std::memory_order_relaxed);
+
+  window_chunks_ = 0;
+  window_rows_ = 0;
+  window_ns_ = 0;
+  window_starved_ = 0;
+  window_blocked_ = 0;
+}
+
+ChunkingStats AdaptiveChunking::stats() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  ChunkingStats stats = totals_;
+  stats.chunk_rows = chunk_rows_.load(std::memory_order_relaxed);
+  stats.queue_depth = queue_depth_.load(std::memory_order_relaxed);
+  stats.ns_per_row = ns_per_row_;
+  return stats;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+static std::mutex last_stats_mutex;
+static ChunkingStats last_stats;
+
+void record_chunking_stats(const ChunkingStats& stats) {
+  std::lock_guard<std::mutex> lock(last_stats_mutex);
+  last_stats = stats;
+}
+
+std::string last_chunking_stats() {
+  std::lock_guard<std::mutex> lock(last_stats_mutex);
+  std::ostringstream out;
+  out << std::fixed << std::setprecision(1)
+      << "chunk_rows===" << last_stats.chunk_rows << "|||queue_depth===" << last_stats.queue_depth
+      << "|||chunks===" << last_stats.chunks << "|||starved_chunks===" << last_stats.starved_chunks
+      << "|||blocked_chunks===" << last_stats.blocked_chunks << "|||ns_per_row===" << last_stats.ns_per_row
+      << "|||bytes_per_row===" << last_stats.bytes_per_row;
+  return out.str();
+}
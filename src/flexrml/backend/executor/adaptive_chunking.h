@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+// Values chosen by the controller, reported in the run stats
+struct ChunkingStats {
+  size_t chunk_rows = 0;      // rows per chunk at the end of the run
+  size_t queue_depth = 0;     // chunks in flight at the end of the run
+  size_t chunks = 0;
+  size_t starved_chunks = 0;  // chunks a producer had to wait for
+  size_t blocked_chunks = 0;  // chunks the reader had to hold back
+  double ns_per_row = 0;
+  double bytes_per_row = 0;
+};
+
+// Adapts the chunk size and queue depth of a reader -> producers pipeline while it runs.
+// A chunk is sized so that its rows and the triples generated from them stay in the cache of a core,
+// and so that processing it takes long enough to make the queue overhead negligible.
+// The queue depth is the number of chunks handed to the producers and not yet processed.
+// It grows while producers starve although the reader keeps up in bursts, and shrinks
+// while the producers are the bottleneck and the buffered chunks only occupy memory.
+class AdaptiveChunking {
+ public:
+  // max_depth is the capacity of the queue between reader and producers
+  AdaptiveChunking(size_t producers, size_t max_depth);
+
+  // Reader: rows the next chunk should hold
+  size_t chunk_rows() const { return chunk_rows_.load(std::memory_order_relaxed); }
+  // Reader: record the width of a full chunk, blocks while queue_depth chunks are in flight
+  void chunk_read(size_t rows, size_t bytes);
+
+  // Producer: record the time spent on a chunk, starved if the producer found the queue empty
+  void chunk_processed(size_t rows, std::chrono::nanoseconds elapsed, bool starved);
+
+  ChunkingStats stats() const;
+
+ private:
+  void update_chunk_rows();
+  void adapt();
+
+  size_t min_depth_;
+  size_t max_depth_;
+  std::atomic<size_t> chunk_rows_;
+  std::atomic<size_t> queue_depth_;
+  std::atomic<uint32_t> in_flight_{0};
+
+  mutable std::mutex mutex_;
+  double read_rows_ = 0;
+  double read_bytes_ = 0;
+  double ns_per_row_ = 0;
+  ChunkingStats totals_;
+
+  // Measurements since the last adaptation
+  size_t window_chunks_ = 0;
+  size_t window_rows_ = 0;
+  double window_ns_ = 0;
+  size_t window_starved_ = 0;
+  size_t window_blocked_ = 0;
+};
+
+// Stats of the last finished pipeline, as key===value|||key===value
+void record_chunking_stats(const ChunkingStats& stats);
+std::string last_chunking_stats();
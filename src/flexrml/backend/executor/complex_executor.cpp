@@ -1,4 +1,5 @@
 #include <algorithm>
+#include <array>
 #include <atomic>
 #include <cctype>
 #include <chrono>
@@ -10,6 +11,8 @@
 #include <functional>
 #include <iostream>
 #include <mutex>
+#include <numeric>
+#include <optional>
 #include <queue>
 #include <string>
 #include <thread>
@@ -18,6 +21,11 @@
 #include <vector>
 
 #include "definitions.h"
+#include "join_index.h"
+#include "mpmc_queue.h"
+#include "output_writer.h"
+#include "resource_manager.h"
+#include "scheduler.h"
 #include "utils.h"
 
 namespace fs = std::filesystem;
@@ -70,24 +78,80 @@ std::vector<int> get_projected_indices(const std::vector<std::string>& proj_attr
   return indices;
 }
 
-// Determine the join index within the projected attributes.
-int get_join_index(const std::vector<std::string>& proj_attrs, const std::string& prefix, const std::string& join_attr) {
-  for (size_t i = 0; i < proj_attrs.size(); ++i) {
-    if (prefix + "_" + proj_attrs[i] == join_attr) {
-      return static_cast<int>(i);  // Found index
+// Determine the join indices within the projected attributes.
+std::vector<int> get_join_indices(const std::vector<std::string>& proj_attrs, const std::string& prefix, const std::vector<std::string>& join_attrs) {
+  std::vector<int> indices;
+  indices.reserve(join_attrs.size());
+
+  for (const auto& join_attr : join_attrs) {
+    bool found = false;
+    for (size_t i = 0; i < proj_attrs.size(); ++i) {
+      if (prefix + "_" + proj_attrs[i] == join_attr) {
+        indices.push_back(static_cast<int>(i));  // Found index
+        found = true;
+        break;
+      }
+    }
+
+    if (!found) {
+      std::cerr << "Error: Join attribute " << join_attr << " not found in projected attributes." << std::endl;
+      std::exit(1);
+    }
+  }
+
+  return indices;
+}
+
+// Split the join conditions of a hash_join line ("hash_join|||L1===R1|||L2===R2") into left and right attributes.
+void parse_join_conditions(const std::vector<std::string>& join_line, std::vector<std::string>& left_join_attrs, std::vector<std::string>& right_join_attrs) {
+  for (size_t i = 1; i < join_line.size(); ++i) {
+    std::vector<std::string> join_mapping = split_by_substring(join_line[i], "===");
+    if (join_mapping.size() != 2) {
+      std::cout << "Error: Malformed join condition. Got: " << join_line[i] << std::endl;
+      std::exit(1);
     }
+    left_join_attrs.push_back(join_mapping[0]);
+    right_join_attrs.push_back(join_mapping[1]);
   }
 
-  std::cerr << "Error: Join attribute " << join_attr << " not found in projected attributes." << std::endl;
-  std::exit(1);
+  if (left_join_attrs.empty()) {
+    std::cout << "Error: Join without join condition." << std::endl;
+    std::exit(1);
+  }
 }
 
-std::unordered_multimap<std::string, std::vector<std::string>> build_hash_table(std::istream& input_file,
-                                                                                const std::vector<int>& projected_indeces,
-                                                                                int filtered_join_index) {
+// Compare the (composite) join keys of two rows column by column.
+template <typename LeftRow, typename RightRow>
+bool join_keys_equal(const LeftRow& left_row, const std::vector<int>& left_join_indices,
+                     const RightRow& right_row, const std::vector<int>& right_join_indices) {
+  for (size_t i = 0; i < left_join_indices.size(); ++i) {
+    if (left_row[left_join_indices[i]] != right_row[right_join_indices[i]]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Store the probe side projection of a line read by a shared scan.
+void collect_probe_row(const std::vector<std::string>& split_line, const std::vector<int>& probe_indices, std::vector<std::vector<std::string>>& probe_rows) {
+  std::vector<std::string> projected_row;
+  projected_row.reserve(probe_indices.size());
+  for (int idx : probe_indices) {
+    projected_row.push_back(split_line[idx]);
+  }
+  probe_rows.push_back(std::move(projected_row));
+}
+
+// Build side of the hash join. Rows are keyed by the combined hash of their join columns,
+// the key columns are compared on probe to resolve collisions.
+// During a shared scan (self join) the projection of the probe side is collected from the same lines.
+JoinHashTable build_hash_table(std::istream& input_file,
+                               const std::vector<int>& projected_indeces,
+                               const std::vector<int>& join_indices,
+                               const std::vector<int>* probe_indices = nullptr,
+                               std::vector<std::vector<std::string>>* probe_rows = nullptr) {
   // Reserve for our hash table and duplicate check set.
-  std::unordered_multimap<std::string, std::vector<std::string>> hash_table;
-  hash_table.reserve(1024 * 1024 * 2);
+  JoinHashTable hash_table;
   std::unordered_set<uint64_t> unique_hashes;
   unique_hashes.reserve(1024 * 1024);
 
@@ -103,6 +167,9 @@ std::unordered_multimap<std::string, std::vector<std::string>> build_hash_table(
       // Process the current batch.
       for (const auto& batch_line : batch_lines) {
         auto split_line = split_csv_line(batch_line, ',');
+        if (probe_rows != nullptr) {
+          collect_probe_row(split_line, *probe_indices, *probe_rows);
+        }
 
         // Build the projected row.
         std::vector<std::string> projected_row;
@@ -129,8 +196,8 @@ std::unordered_multimap<std::string, std::vector<std::string>> build_hash_table(
         }
 
         // Insert into hash table.
-        std::string key = projected_row[filtered_join_index];
-        hash_table.emplace(std::move(key), std::move(projected_row));
+        uint64_t key_hash = combinedHash(projected_row, join_indices);
+        hash_table.insert(key_hash, projected_row);
       }
       batch_lines.clear();
     }
@@ -139,6 +206,9 @@ std::unordered_multimap<std::string, std::vector<std::string>> build_hash_table(
   // Process any remaining lines that didn't fill a full batch.
   for (const auto& batch_line : batch_lines) {
     auto split_line = split_csv_line(batch_line, ',');
+    if (probe_rows != nullptr) {
+      collect_probe_row(split_line, *probe_indices, *probe_rows);
+    }
     std::vector<std::string> projected_row;
     projected_row.reserve(projected_indeces.size());
     for (int idx : projected_indeces) {
@@ -160,10 +230,11 @@ std::unordered_multimap<std::string, std::vector<std::string>> build_hash_table(
       continue;
     }
 
-    std::string key = projected_row[filtered_join_index];
-    hash_table.emplace(std::move(key), std::move(projected_row));
+    uint64_t key_hash = combinedHash(projected_row, join_indices);
+    hash_table.insert(key_hash, projected_row);
   }
 
+  hash_table.finish();
   return hash_table;
 }
 
@@ -181,90 +252,709 @@ static std::unique_ptr<std::istream> open_from_map_or_file(
     return f;
 }
 
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Probe side of a join. Either streams the right input or replays the rows
+// collected by a shared scan.
+class ProbeInput {
+ public:
+  std::unique_ptr<std::istream> file;
+  std::vector<int> projected_indices;
+  std::vector<std::vector<std::string>> buffered_rows;
+  bool buffered = false;
+
+  bool next(std::vector<std::string>& projected_row) {
+    projected_row.clear();
+    if (buffered) {
+      if (position_ == buffered_rows.size()) {
+        return false;
+      }
+      projected_row = std::move(buffered_rows[position_++]);
+      return true;
+    }
 
-int execute_complex(const fs::path& output_file_name,
-                     const std::string& left_path,
+    if (!std::getline(*file, line_)) {
+      return false;
+    }
+    auto split_line = split_csv_line(line_, ',');
+    ////// PROJECTION //////
+    for (int i : projected_indices) {
+      projected_row.push_back(split_line[i]);
+    }
+    return true;
+  }
+
+ private:
+  std::string line_;
+  size_t position_ = 0;
+};
+
+// Keys matching at least this many build rows are heavy hitters.
+constexpr size_t heavy_hitter_min_matches = 4096;
+// Matches of a heavy hitter handled by one task.
+constexpr size_t heavy_hitter_chunk_size = 1024;
+// Triples of the heavy hitter probe rows collected before they are joined.
+constexpr size_t heavy_hitter_batch_matches = 64 * 1024;
+
+// Build rows of a heavy hitter key. The rows of a key hash are split by their key columns,
+// so hash collisions are resolved once when the hash table is built.
+struct HeavyHitterKey {
+  std::vector<size_t> matches;  // entries of the hash table
+};
+
+// Everything the probe loop of a join needs.
+struct JoinInputs {
+  JoinHashTable hash_table;
+  ProbeInput probe;
+  std::vector<int> left_join_indices;
+  std::vector<int> right_join_indices;
+  std::vector<std::string> joined_headers;
+  std::string probe_prefix;
+  std::unordered_map<uint64_t, std::vector<HeavyHitterKey>> heavy_hitters;
+
+  // Build side, until the hash table is built
+  std::unique_ptr<std::istream> build_file;
+  std::vector<int> build_indices;
+  bool shared_scan = false;
+};
+
+// Find the keys of the build side whose number of rows makes a single probe row dominate the join.
+std::unordered_map<uint64_t, std::vector<HeavyHitterKey>> find_heavy_hitters(const JoinHashTable& hash_table, const std::vector<int>& join_indices) {
+  std::unordered_map<uint64_t, std::vector<HeavyHitterKey>> heavy_hitters;
+  if (hash_table.size() < heavy_hitter_min_matches) {
+    return heavy_hitters;
+  }
+
+  // Entries with the same key are adjacent in the table
+  size_t entry = 0;
+  while (entry < hash_table.size()) {
+    JoinHashTable::Range range = hash_table.equal_range(hash_table.key_hash(entry));
+    if (range.size() >= heavy_hitter_min_matches) {
+      std::vector<HeavyHitterKey>& keys = heavy_hitters[hash_table.key_hash(entry)];
+      for (size_t match = range.first(); match < range.first() + range.size(); ++match) {
+        auto key = std::find_if(keys.begin(), keys.end(), [&](const HeavyHitterKey& key) {
+          return join_keys_equal(hash_table.row(key.matches.front()), join_indices, hash_table.row(match), join_indices);
+        });
+        if (key == keys.end()) {
+          key = keys.emplace(keys.end());
+        }
+        key->matches.push_back(match);
+      }
+    }
+    entry = range.first() + range.size();
+  }
+  return heavy_hitters;
+}
+
+// Build rows of the key of a probe row if the key is a heavy hitter, nullptr otherwise.
+const HeavyHitterKey* find_heavy_hitter(const JoinInputs& join, uint64_t key_hash, const std::vector<std::string>& projected_row) {
+  auto it = join.heavy_hitters.find(key_hash);
+  if (it == join.heavy_hitters.end()) {
+    return nullptr;
+  }
+  for (const auto& key : it->second) {
+    if (join_keys_equal(join.hash_table.row(key.matches.front()), join.left_join_indices, projected_row, join.right_join_indices)) {
+      return &key;
+    }
+  }
+  return nullptr;
+}
+
+// Open the inputs of a join and resolve the projected and join columns of both sides.
+// With shared_scan both sides come from the same source, which is read only once.
+JoinInputs open_join(const std::string& left_path,
                      const std::string& right_path,
                      const std::string& left_name,
                      const std::string& right_name,
-                     const std::string& left_join_attr,
-                     const std::string& right_join_attr,
-                     const std::string& base_uri,
+                     const std::vector<std::string>& left_join_attrs,
+                     const std::vector<std::string>& right_join_attrs,
                      const std::vector<std::string>& projected_attributes_left,
                      const std::vector<std::string>& projected_attributes_right,
-                     const std::vector<std::string>& s_content,
-                     const std::vector<std::string>& p_content,
-                     const std::vector<std::string>& o_content,
+                     bool shared_scan,
                      const std::unordered_map<std::string, std::string>& data_map) {
-  // Setup
-  std::string line;
-  std::unordered_set<uint64_t> unique_hashes;
-  unique_hashes.reserve(1024 * 1024);
-  size_t triple_counter = 0;
-
-  size_t write_cnt = 0;
-  size_t buffer_limit = 20000;
-  std::string buffered_res;
-
-  // Open output file
-  fs::create_directories(output_file_name.parent_path());
-  std::ofstream outputFile(output_file_name, std::ios::app);
-  if (!outputFile) {
-    std::cerr << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
-
-  //////////////////////////////////////////////////////////////////////
+  JoinInputs join;
+  join.shared_scan = shared_scan;
 
   // Open CSV files
-  auto left_file = open_from_map_or_file(data_map, left_path);
-  auto right_file = open_from_map_or_file(data_map, right_path);
-  if (!left_file || !right_file) {
+  join.build_file = open_from_map_or_file(data_map, left_path);
+  if (!shared_scan) {
+    join.probe.file = open_from_map_or_file(data_map, right_path);
+  }
+  if (!join.build_file || (!shared_scan && !join.probe.file)) {
     std::cerr << "Error opening input files." << std::endl;
     std::exit(1);
   }
 
   // Read header lines
   std::string left_header_line, right_header_line;
-  std::getline(*left_file, left_header_line);
-  std::getline(*right_file, right_header_line);
+  std::getline(*join.build_file, left_header_line);
+  if (shared_scan) {
+    right_header_line = left_header_line;
+  } else {
+    std::getline(*join.probe.file, right_header_line);
+  }
 
   // Build header mappings for left and right files.
   auto [left_headers, left_header_idx] = build_header(left_header_line, left_name);
   auto [right_headers, right_header_idx] = build_header(right_header_line, right_name);
 
-  auto left_proj_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
-  auto right_proj_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
-
-  int left_filtered_join_index = get_join_index(projected_attributes_left, left_name, left_join_attr);
-  int right_filtered_join_index = get_join_index(projected_attributes_right, right_name, right_join_attr);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
+  join.build_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
+  join.probe.projected_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
 
-  // Build hash table from left file (store only projected columns).
-  auto hash_table = build_hash_table(*left_file, left_proj_indices, left_filtered_join_index);
+  join.left_join_indices = get_join_indices(projected_attributes_left, left_name, left_join_attrs);
+  join.right_join_indices = get_join_indices(projected_attributes_right, right_name, right_join_attrs);
 
-  //////////////////////////////////////////////////////////////////////////////////////////////////
   // Prepare joined headers for output.
-  std::vector<std::string> joined_headers;
   for (const auto& attr : projected_attributes_left) {
-    joined_headers.push_back(left_name + "_" + attr);
+    join.joined_headers.push_back(left_name + "_" + attr);
   }
   for (const auto& attr : projected_attributes_right) {
-    joined_headers.push_back(right_name + "_" + attr);
+    join.joined_headers.push_back(right_name + "_" + attr);
   }
+  join.probe_prefix = right_name + "_";
 
-  // Process right file
-  while (getline(*right_file, line)) {
-    auto split_line = split_csv_line(line, ',');
+  return join;
+}
+
+// Build the hash table of the left input, build_table builds it from the opened left file.
+// The persisted join index of an unchanged left file is reused instead of building.
+template <typename BuildTable>
+void build_join(JoinInputs& join,
+                const std::string& left_path,
+                const std::vector<std::string>& left_join_attrs,
+                const std::vector<std::string>& projected_attributes_left,
+                const std::unordered_map<std::string, std::string>& data_map,
+                BuildTable build_table) {
+  if (join.shared_scan) {
+    join.probe.buffered = true;
+    join.hash_table = build_hash_table(*join.build_file, join.build_indices, join.left_join_indices,
+                                       &join.probe.projected_indices, &join.probe.buffered_rows);
+  } else {
+    std::string index_key;
+    if (data_map.find(left_path) == data_map.end()) {
+      index_key = join_index_key(left_path, projected_attributes_left, left_join_attrs);
+    }
+    if (index_key.empty() || !load_join_index(index_key, join.hash_table)) {
+      join.hash_table = build_table(*join.build_file);
+      if (!index_key.empty()) {
+        save_join_index(index_key, join.hash_table);
+      }
+    }
+  }
+  join.build_file.reset();
+
+  join.heavy_hitters = find_heavy_hitters(join.hash_table, join.left_join_indices);
+}
+
+// Open the inputs of a join and build the hash table of the left input.
+JoinInputs prepare_join(const std::string& left_path,
+                        const std::string& right_path,
+                        const std::string& left_name,
+                        const std::string& right_name,
+                        const std::vector<std::string>& left_join_attrs,
+                        const std::vector<std::string>& right_join_attrs,
+                        const std::vector<std::string>& projected_attributes_left,
+                        const std::vector<std::string>& projected_attributes_right,
+                        bool shared_scan,
+                        const std::unordered_map<std::string, std::string>& data_map) {
+  JoinInputs join = open_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                              projected_attributes_left, projected_attributes_right, shared_scan, data_map);
+  build_join(join, left_path, left_join_attrs, projected_attributes_left, data_map, [&join](std::istream& input) {
+    return build_hash_table(input, join.build_indices, join.left_join_indices);
+  });
+  return join;
+}
+
+// True if a term only references attributes of the probe side, so it is the same for all matches of a probe row.
+bool is_probe_side_term(const std::vector<std::string>& content, const std::string& probe_prefix) {
+  if (content[1] == "preformatted" || content[1] == "constant") {
+    return true;
+  } else if (content[1] == "reference") {
+    return content[0].rfind(probe_prefix, 0) == 0;
+  } else if (content[1] == "template") {
+    size_t start = content[0].find('{');
+    while (start != std::string::npos) {
+      if (content[0].compare(start + 1, probe_prefix.size(), probe_prefix) != 0) {
+        return false;
+      }
+      start = content[0].find('{', start + 1);
+    }
+    return true;
+  }
+  return false;
+}
+
+// Create one term of a triple. Terms are ordered subject, predicate, object, graph.
+std::string create_term(const std::vector<std::string>& content, size_t position, const std::string& base_uri, std::unordered_map<std::string, std::string>& row_map) {
+  if (content[1] == "preformatted") {
+    return content[0];
+  }
+  if (position == 2) {
+    return create_operator(content[0], content[1], content[2], content[3], content[4], base_uri, row_map);
+  }
+  return create_operator(content[0], content[1], content[2], "", "", base_uri, row_map);
+}
+
+// Probe rows whose key is a heavy hitter, joined together once enough matches are collected.
+// Terms that only reference the probe side are created once per probe row. The matches of a key
+// are split into chunks, a chunk is joined with all probe rows of the key and the chunks of the
+// batch run in parallel as one job.
+class HeavyHitterBatch {
+ public:
+  HeavyHitterBatch(const JoinInputs& join, const std::vector<std::vector<std::string>>& contents, const std::string& base_uri)
+      : join_(join), contents_(contents), base_uri_(base_uri), is_shared_(contents.size()) {
+    for (size_t t = 0; t < contents.size(); ++t) {
+      is_shared_[t] = is_probe_side_term(contents[t], join.probe_prefix);
+    }
+  }
+
+  void add(const HeavyHitterKey& key, const std::vector<std::string>& projected_row) {
+    Probe probe;
+    size_t left_width = join_.joined_headers.size() - projected_row.size();
+    for (size_t i = 0; i < projected_row.size(); ++i) {
+      probe.row_map[join_.joined_headers[left_width + i]] = projected_row[i];
+    }
+    probe.terms.resize(contents_.size());
+    try {
+      for (size_t t = 0; t < contents_.size(); ++t) {
+        if (is_shared_[t]) {
+          probe.terms[t] = create_term(contents_[t], t, base_uri_, probe.row_map);
+        }
+      }
+    } catch (const std::runtime_error& e) {
+      if (continue_on_error == false) {
+        std::cout << e.what() << std::endl;
+        std::exit(1);
+      }
+      return;
+    }
+
+    auto [it, inserted] = probes_.try_emplace(&key);
+    if (inserted) {
+      keys_.push_back(&key);
+    }
+    it->second.push_back(std::move(probe));
+    pending_matches_ += key.matches.size();
+  }
+
+  bool full() const { return pending_matches_ >= heavy_hitter_batch_matches; }
+
+  // Join the collected probe rows and append the triples to output. Returns their number.
+  // Inside the scheduler the chunks become subtasks, idle workers steal them. Without threading
+  // they run on the calling thread.
+  size_t flush(std::string& output) {
+    std::vector<std::pair<const HeavyHitterKey*, size_t>> chunks;
+    for (const HeavyHitterKey* key : keys_) {
+      for (size_t begin = 0; begin < key->matches.size(); begin += heavy_hitter_chunk_size) {
+        chunks.emplace_back(key, begin);
+      }
+    }
+
+    std::vector<std::string> results(chunks.size());
+    std::vector<size_t> counts(chunks.size());
+    auto join_chunk = [&](size_t c) {
+      const auto& [key, begin] = chunks[c];
+      size_t end = std::min(key->matches.size(), begin + heavy_hitter_chunk_size);
+      size_t left_width = join_.joined_headers.size() - join_.probe.projected_indices.size();
+      for (const Probe& probe : probes_.at(key)) {
+        std::unordered_map<std::string, std::string> row_map = probe.row_map;
+        std::vector<std::string> terms = probe.terms;
+        for (size_t m = begin; m < end; ++m) {
+          JoinHashTable::Row left_row = join_.hash_table.row(key->matches[m]);
+          for (size_t i = 0; i < left_width; ++i) {
+            row_map[join_.joined_headers[i]] = left_row[i];
+          }
+
+          try {
+            for (size_t t = 0; t < contents_.size(); ++t) {
+              if (!is_shared_[t]) {
+                terms[t] = create_term(contents_[t], t, base_uri_, row_map);
+              }
+            }
+          } catch (const std::runtime_error& e) {
+            if (continue_on_error == false) {
+              std::cout << e.what() << std::endl;
+              std::exit(1);
+            } else {
+              continue;
+            }
+          }
+
+          results[c] += terms[0];
+          for (size_t t = 1; t < terms.size(); ++t) {
+            results[c].append(" ").append(terms[t]);
+          }
+          results[c] += " .\n";
+          counts[c]++;
+        }
+      }
+    };
+
+    if (Scheduler* scheduler = Scheduler::current(); scheduler != nullptr && chunks.size() > 1) {
+      TaskGroup group(*scheduler);
+      for (size_t c = 1; c < chunks.size(); ++c) {
+        group.run([&join_chunk, c] { join_chunk(c); });
+      }
+      join_chunk(0);
+      group.wait();
+    } else {
+      for (size_t c = 0; c < chunks.size(); ++c) {
+        join_chunk(c);
+      }
+    }
+
+    size_t triples = 0;
+    for (size_t c = 0; c < chunks.size(); ++c) {
+      output += results[c];
+      triples += counts[c];
+    }
+    probes_.clear();
+    keys_.clear();
+    pending_matches_ = 0;
+    return triples;
+  }
+
+ private:
+  struct Probe {
+    std::unordered_map<std::string, std::string> row_map;  // probe side columns
+    std::vector<std::string> terms;                         // shared terms, set when created once
+  };
+
+  const JoinInputs& join_;
+  const std::vector<std::vector<std::string>>& contents_;
+  const std::string& base_uri_;
+  std::vector<bool> is_shared_;
+  std::unordered_map<const HeavyHitterKey*, std::vector<Probe>> probes_;
+  std::vector<const HeavyHitterKey*> keys_;  // in the order of their first probe row
+  size_t pending_matches_ = 0;
+};
+
+// Join the collected probe rows of a dependent plan and insert the triples into unique_triple.
+void collect_heavy_hitters(HeavyHitterBatch& batch, TripleCollector& unique_triple) {
+  std::string triples;
+  batch.flush(triples);
+  size_t line_start = 0;
+  while (line_start < triples.size()) {
+    size_t line_end = triples.find('\n', line_start) + 1;
+    unique_triple.insert(triples.substr(line_start, line_end - line_start));
+    line_start = line_end;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+//// PIPELINED JOIN ////
+
+// Lines or rows per chunk handed between two stages
+constexpr size_t pipeline_chunk_size = 1024;
+// Chunks a stage may run ahead of the next one
+constexpr size_t pipeline_queue_capacity = 64;
+
+// Input handed from a reader to the workers. Chunks of a file carry the raw lines, chunks of a
+// shared scan carry the rows projected during the build. Entries past size are kept for reuse.
+struct JoinInputChunk {
+  std::vector<std::string> lines;
+  std::vector<std::vector<std::string>> rows;
+  size_t size = 0;
+  bool projected = false;
+  void reset() {
+    size = 0;
+    projected = false;
+  }
+};
+
+// A row of the build side, hashed by the worker that projected it
+struct BuildRow {
+  uint64_t hash;
+  uint64_t key_hash;
+  std::vector<std::string> row;
+};
+
+bool has_skipped_value(const std::vector<std::string>& row) {
+  for (const auto& target : values_to_skip) {
+    if (std::any_of(row.begin(), row.end(), [&target](const std::string& s) { return s == target; })) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Read the lines of input into chunks, the queue is finished at the end of input.
+void read_line_chunks(std::istream& input, BoundedMPMCQueue<JoinInputChunk>& queue, ChunkPool<JoinInputChunk>& pool) {
+  JoinInputChunk chunk = pool.acquire();
+  for (;;) {
+    if (chunk.size == chunk.lines.size()) {
+      chunk.lines.emplace_back();
+    }
+    if (!std::getline(input, chunk.lines[chunk.size])) {
+      break;
+    }
+    if (++chunk.size == pipeline_chunk_size) {
+      queue.push(std::move(chunk));
+      chunk = pool.acquire();
+    }
+  }
+  if (chunk.size > 0) {
+    queue.push(std::move(chunk));
+  }
+  queue.set_finished();
+}
 
+// Hand the rows buffered by a shared scan to the workers in chunks, then finish the queue.
+void replay_row_chunks(std::vector<std::vector<std::string>>& rows, BoundedMPMCQueue<JoinInputChunk>& queue, ChunkPool<JoinInputChunk>& pool) {
+  for (size_t begin = 0; begin < rows.size(); begin += pipeline_chunk_size) {
+    size_t end = std::min(rows.size(), begin + pipeline_chunk_size);
+    JoinInputChunk chunk = pool.acquire();
+    chunk.projected = true;
+    chunk.rows.resize(std::max(chunk.rows.size(), end - begin));
+    for (size_t i = begin; i < end; ++i) {
+      chunk.rows[chunk.size++] = std::move(rows[i]);
+    }
+    queue.push(std::move(chunk));
+  }
+  queue.set_finished();
+}
+
+// Run the workers of a stage, the calling thread is one of them. Inside the scheduler the other
+// workers are subtasks. They only wait for readers and writers running on their own threads,
+// so a blocked worker never waits for a queued task. Otherwise the threads are leased from the CPU budget.
+void run_stage_workers(const std::function<void()>& worker) {
+  if (Scheduler* scheduler = Scheduler::current(); scheduler != nullptr) {
+    TaskGroup workers(*scheduler);
+    for (size_t i = 1; i < scheduler->num_workers(); ++i) {
+      workers.run(worker);
+    }
+    worker();
+    workers.wait();
+    return;
+  }
+
+  ThreadLease lease(ResourceManager::instance().budget());
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < lease.count(); ++i) {
+    threads.emplace_back(worker);
+  }
+  worker();
+  for (auto& thread : threads) {
+    thread.join();
+  }
+}
+
+// Build side of a pipelined join. A reader thread hands chunks of lines to the workers, which split,
+// project and hash them in parallel. The rows are then inserted into the hash table in one pass.
+JoinHashTable build_hash_table_parallel(std::istream& input_file, const std::vector<int>& projected_indices, const std::vector<int>& join_indices) {
+  BoundedMPMCQueue<JoinInputChunk> line_queue(pipeline_queue_capacity);
+  ChunkPool<JoinInputChunk> line_pool(2 * pipeline_queue_capacity);
+  std::thread reader(read_line_chunks, std::ref(input_file), std::ref(line_queue), std::ref(line_pool));
+
+  std::mutex parts_mutex;
+  std::vector<std::vector<BuildRow>> parts;
+  run_stage_workers([&]() {
+    std::vector<BuildRow> part;
+    JoinInputChunk chunk;
+    while (line_queue.pop(chunk)) {
+      for (size_t i = 0; i < chunk.size; ++i) {
+        auto split_line = split_csv_line(chunk.lines[i], ',');
+        BuildRow build_row;
+        build_row.row.reserve(projected_indices.size());
+        for (int idx : projected_indices) {
+          build_row.row.push_back(split_line[idx]);
+        }
+        if (has_skipped_value(build_row.row)) {
+          continue;
+        }
+        build_row.hash = combinedHash(build_row.row);
+        build_row.key_hash = combinedHash(build_row.row, join_indices);
+        part.push_back(std::move(build_row));
+      }
+      line_pool.release(std::move(chunk));
+    }
+    std::lock_guard<std::mutex> lock(parts_mutex);
+    parts.push_back(std::move(part));
+  });
+  reader.join();
+
+  // Eliminate duplicates and insert into the hash table
+  JoinHashTable hash_table;
+  std::unordered_set<uint64_t> unique_hashes;
+  unique_hashes.reserve(1024 * 1024);
+  for (auto& part : parts) {
+    for (auto& build_row : part) {
+      if (unique_hashes.insert(build_row.hash).second) {
+        hash_table.insert(build_row.key_hash, build_row.row);
+      }
+      std::vector<std::string>().swap(build_row.row);
+    }
+  }
+  hash_table.finish();
+  return hash_table;
+}
+
+// Hash join as a pipeline of stages connected by bounded queues. A reader thread reads the probe
+// file while the hash table is built in parallel, then several workers probe and format chunks of
+// probe rows and hand their triples to the output writer.
+// contents holds the terms of the triple: subject, predicate, object and optionally graph.
+size_t execute_complex_pipelined(const fs::path& output_file_name,
+                                 const std::string& left_path,
+                                 const std::string& right_path,
+                                 const std::string& left_name,
+                                 const std::string& right_name,
+                                 const std::vector<std::string>& left_join_attrs,
+                                 const std::vector<std::string>& right_join_attrs,
+                                 const std::string& base_uri,
+                                 const std::vector<std::string>& projected_attributes_left,
+                                 const std::vector<std::string>& projected_attributes_right,
+                                 const std::vector<std::vector<std::string>>& contents,
+                                 bool shared_scan,
+                                 const std::unordered_map<std::string, std::string>& data_map) {
+  OutputWriter& output = output_writer(output_file_name);
+
+  JoinInputs join = open_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                              projected_attributes_left, projected_attributes_right, shared_scan, data_map);
+
+  BoundedMPMCQueue<JoinInputChunk> probe_queue(pipeline_queue_capacity);
+  ChunkPool<JoinInputChunk> probe_pool(2 * pipeline_queue_capacity);
+
+  // The probe file is read ahead while the hash table is built
+  std::thread probe_reader;
+  if (!shared_scan) {
+    probe_reader = std::thread(read_line_chunks, std::ref(*join.probe.file), std::ref(probe_queue), std::ref(probe_pool));
+  }
+
+  build_join(join, left_path, left_join_attrs, projected_attributes_left, data_map, [&join](std::istream& input) {
+    return build_hash_table_parallel(input, join.build_indices, join.left_join_indices);
+  });
+  if (shared_scan) {
+    probe_reader = std::thread(replay_row_chunks, std::ref(join.probe.buffered_rows), std::ref(probe_queue), std::ref(probe_pool));
+  }
+
+  // Process right rows
+  auto seen_rows = std::make_unique<ConcurrentHashSet>();
+  std::atomic<size_t> triple_counter{0};
+  size_t left_width = join.joined_headers.size() - join.probe.projected_indices.size();
+  run_stage_workers([&]() {
+    JoinInputChunk chunk;
     std::vector<std::string> projected_row;
-    ////// PROJECTION //////
-    for (int i : right_proj_indices) {
-      projected_row.push_back(split_line[i]);
+    std::unordered_map<std::string, std::string> row_map;
+    std::vector<std::string> terms(contents.size());
+    std::string buffered_res;
+    HeavyHitterBatch heavy_hitters(join, contents, base_uri);
+    while (probe_queue.pop(chunk)) {
+      size_t chunk_triples = 0;
+      for (size_t r = 0; r < chunk.size; ++r) {
+        ////// PROJECTION //////
+        if (chunk.projected) {
+          projected_row = std::move(chunk.rows[r]);
+        } else {
+          auto split_line = split_csv_line(chunk.lines[r], ',');
+          projected_row.clear();
+          for (int i : join.probe.projected_indices) {
+            projected_row.push_back(split_line[i]);
+          }
+        }
+
+        // Check for unwanted values and eliminate duplicates
+        if (has_skipped_value(projected_row) || !seen_rows->insert(combinedHash(projected_row))) {
+          continue;
+        }
+
+        uint64_t key_hash = combinedHash(projected_row, join.right_join_indices);
+        auto range = join.hash_table.equal_range(key_hash);
+
+        // Skewed keys are joined separately
+        if (const HeavyHitterKey* heavy_key = find_heavy_hitter(join, key_hash, projected_row); heavy_key != nullptr) {
+          heavy_hitters.add(*heavy_key, projected_row);
+          if (heavy_hitters.full()) {
+            chunk_triples += heavy_hitters.flush(buffered_res);
+          }
+          continue;
+        }
+
+        for (size_t i = 0; i < projected_row.size(); ++i) {
+          row_map[join.joined_headers[left_width + i]] = projected_row[i];
+        }
+        for (JoinHashTable::Row left_row : range) {
+          // Resolve hash collisions
+          if (!join_keys_equal(left_row, join.left_join_indices, projected_row, join.right_join_indices)) {
+            continue;
+          }
+          for (size_t i = 0; i < left_width; ++i) {
+            row_map[join.joined_headers[i]] = left_row[i];
+          }
+
+          ////// CREATE //////
+          try {
+            for (size_t t = 0; t < contents.size(); ++t) {
+              terms[t] = create_term(contents[t], t, base_uri, row_map);
+            }
+          } catch (const std::runtime_error& e) {
+            if (continue_on_error == false) {
+              std::cout << e.what() << std::endl;
+              std::exit(1);
+            } else {
+              continue;
+            }
+          }
+
+          buffered_res += terms[0];
+          for (size_t t = 1; t < terms.size(); ++t) {
+            buffered_res.append(" ").append(terms[t]);
+          }
+          buffered_res += " .\n";
+          chunk_triples++;
+        }
+      }
+      probe_pool.release(std::move(chunk));
+
+      ////// SERIALIZE //////
+      triple_counter.fetch_add(chunk_triples, std::memory_order_relaxed);
+      output.write(buffered_res);
     }
+    triple_counter.fetch_add(heavy_hitters.flush(buffered_res), std::memory_order_relaxed);
+    output.write(buffered_res);
+  });
+
+  probe_reader.join();
+
+  return triple_counter.load();
+}
 
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+int execute_complex(const fs::path& output_file_name,
+                     const std::string& left_path,
+                     const std::string& right_path,
+                     const std::string& left_name,
+                     const std::string& right_name,
+                     const std::vector<std::string>& left_join_attrs,
+                     const std::vector<std::string>& right_join_attrs,
+                     const std::string& base_uri,
+                     const std::vector<std::string>& projected_attributes_left,
+                     const std::vector<std::string>& projected_attributes_right,
+                     const std::vector<std::string>& s_content,
+                     const std::vector<std::string>& p_content,
+                     const std::vector<std::string>& o_content,
+                     bool shared_scan,
+                     const std::unordered_map<std::string, std::string>& data_map) {
+  // Setup
+  std::unordered_set<uint64_t> unique_hashes;
+  unique_hashes.reserve(1024 * 1024);
+  size_t triple_counter = 0;
+
+  size_t write_cnt = 0;
+  size_t buffer_limit = 20000;
+  std::string buffered_res;
+
+  OutputWriter& output = output_writer(output_file_name);
+
+  //////////////////////////////////////////////////////////////////////
+  // Open inputs and build hash table from left file
+  JoinInputs join = prepare_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                                 projected_attributes_left, projected_attributes_right, shared_scan, data_map);
+
+  std::vector<std::vector<std::string>> contents = {s_content, p_content, o_content};
+  HeavyHitterBatch heavy_hitters(join, contents, base_uri);
+
+  // Process right rows
+  std::vector<std::string> projected_row;
+  while (join.probe.next(projected_row)) {
     // Check for unwanted values
     bool skip = false;
     for (const auto& target : values_to_skip) {
@@ -283,19 +973,37 @@ int execute_complex(const fs::path& output_file_name,
       continue;
     }
 
-    std::string key = projected_row[right_filtered_join_index];
-    auto range = hash_table.equal_range(key);
+    uint64_t key_hash = combinedHash(projected_row, join.right_join_indices);
+    auto range = join.hash_table.equal_range(key_hash);
+
+    // Skewed keys are joined separately
+    if (const HeavyHitterKey* heavy_key = find_heavy_hitter(join, key_hash, projected_row); heavy_key != nullptr) {
+      heavy_hitters.add(*heavy_key, projected_row);
+      if (heavy_hitters.full()) {
+        triple_counter += heavy_hitters.flush(buffered_res);
+        ////// SERIALIZE //////
+        output.write(buffered_res);
+      }
+      continue;
+    }
+
+    for (JoinHashTable::Row left_row : range) {
+      // Resolve hash collisions
+      if (!join_keys_equal(left_row, join.left_join_indices, projected_row, join.right_join_indices)) {
+        continue;
+      }
 
-    for (auto it = range.first; it != range.second; ++it) {
       // Combine left and right filtered rows
       std::vector<std::string> joined_row;
-      joined_row.insert(joined_row.end(), it->second.begin(), it->second.end());
+      for (size_t i = 0; i < left_row.size(); ++i) {
+        joined_row.emplace_back(left_row[i]);
+      }
       joined_row.insert(joined_row.end(), projected_row.begin(), projected_row.end());
 
       // Map headers to values
       std::unordered_map<std::string, std::string> row_map;
-      for (size_t i = 0; i < joined_headers.size(); ++i)
-        row_map[joined_headers[i]] = joined_row[i];
+      for (size_t i = 0; i < join.joined_headers.size(); ++i)
+        row_map[join.joined_headers[i]] = joined_row[i];
 
       // Generate triple
       std::string subject;
@@ -340,89 +1048,50 @@ int execute_complex(const fs::path& output_file_name,
       if (write_cnt == buffer_limit) {
         write_cnt = 0;
         ////// SERIALIZE //////
-        outputFile << buffered_res;
-        buffered_res = "";
+        output.write(buffered_res);
       }
     }
   }
 
-  ////// SERIALIZE //////
-  outputFile << buffered_res;
-
-  return triple_counter;
-}
-////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-
-std::unordered_set<std::string> execute_complex_dependent(const fs::path& output_file_name,
-                                                          const std::string& left_path,
-                                                          const std::string& right_path,
-                                                          const std::string& left_name,
-                                                          const std::string& right_name,
-                                                          const std::string& left_join_attr,
-                                                          const std::string& right_join_attr,
-                                                          const std::string& base_uri,
-                                                          const std::vector<std::string>& projected_attributes_left,
-                                                          const std::vector<std::string>& projected_attributes_right,
-                                                          const std::vector<std::string>& s_content,
-                                                          const std::vector<std::string>& p_content,
-                                                          const std::vector<std::string>& o_content,
-                                                          std::unordered_set<std::string>& unique_triple,
-                                                          const std::unordered_map<std::string, std::string>& data_map) {
-  // Setup
-  std::string line;
-  std::unordered_set<uint64_t> unique_hashes;
-
-  //////////////////////////////////////////////////////////////////////
-  // Open CSV files
-  auto left_file = open_from_map_or_file(data_map, left_path);
-  auto right_file = open_from_map_or_file(data_map, right_path);
-
-  if (!left_file || !right_file) {
-    std::cerr << "Error opening input files." << std::endl;
-    std::exit(1);
-  }
-
-  // Read header lines
-  std::string left_header_line, right_header_line;
-  std::getline(*left_file, left_header_line);
-  std::getline(*right_file, right_header_line);
-
-  // Build header mappings for left and right files.
-  auto [left_headers, left_header_idx] = build_header(left_header_line, left_name);
-  auto [right_headers, right_header_idx] = build_header(right_header_line, right_name);
-
-  auto left_proj_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
-  auto right_proj_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
-
-  int left_filtered_join_index = get_join_index(projected_attributes_left, left_name, left_join_attr);
-  int right_filtered_join_index = get_join_index(projected_attributes_right, right_name, right_join_attr);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
+  triple_counter += heavy_hitters.flush(buffered_res);
 
-  // Build hash table from left file using the left join index
-  auto hash_table = build_hash_table(*left_file, left_proj_indices, left_filtered_join_index);
+  ////// SERIALIZE //////
+  output.write(buffered_res);
 
-  //////////////////////////////////////////////////////////////////////////////////////////////////
+  return triple_counter;
+}
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-  // Prepare joined headers for output.
-  std::vector<std::string> joined_headers;
-  for (const auto& attr : projected_attributes_left) {
-    joined_headers.push_back(left_name + "_" + attr);
-  }
-  for (const auto& attr : projected_attributes_right) {
-    joined_headers.push_back(right_name + "_" + attr);
-  }
+void execute_complex_dependent(const fs::path& output_file_name,
+                               const std::string& left_path,
+                               const std::string& right_path,
+                               const std::string& left_name,
+                               const std::string& right_name,
+                               const std::vector<std::string>& left_join_attrs,
+                               const std::vector<std::string>& right_join_attrs,
+                               const std::string& base_uri,
+                               const std::vector<std::string>& projected_attributes_left,
+                               const std::vector<std::string>& projected_attributes_right,
+                               const std::vector<std::string>& s_content,
+                               const std::vector<std::string>& p_content,
+                               const std::vector<std::string>& o_content,
+                               TripleCollector& unique_triple,
+                               bool shared_scan,
+                               const std::unordered_map<std::string, std::string>& data_map) {
+  // Setup
+  std::unordered_set<uint64_t> unique_hashes;
 
-  // Process right file
-  while (getline(*right_file, line)) {
-    auto split_line = split_csv_line(line, ',');
+  //////////////////////////////////////////////////////////////////////
+  // Open inputs and build hash table from left file
+  JoinInputs join = prepare_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                                 projected_attributes_left, projected_attributes_right, shared_scan, data_map);
 
-    std::vector<std::string> projected_row;
-    ////// PROJECTION //////
-    for (int i : right_proj_indices) {
-      projected_row.push_back(split_line[i]);
-    }
+  std::vector<std::vector<std::string>> contents = {s_content, p_content, o_content};
+  HeavyHitterBatch heavy_hitters(join, contents, base_uri);
 
+  // Process right rows
+  std::vector<std::string> projected_row;
+  while (join.probe.next(projected_row)) {
     // Check for unwanted values
     bool skip = false;
     for (const auto& target : values_to_skip) {
@@ -441,19 +1110,35 @@ std::unordered_set<std::string> execute_complex_dependent(const fs::path& output
       continue;
     }
 
-    std::string key = projected_row[right_filtered_join_index];
-    auto range = hash_table.equal_range(key);
+    uint64_t key_hash = combinedHash(projected_row, join.right_join_indices);
+    auto range = join.hash_table.equal_range(key_hash);
+
+    // Skewed keys are joined separately
+    if (const HeavyHitterKey* heavy_key = find_heavy_hitter(join, key_hash, projected_row); heavy_key != nullptr) {
+      heavy_hitters.add(*heavy_key, projected_row);
+      if (heavy_hitters.full()) {
+        collect_heavy_hitters(heavy_hitters, unique_triple);
+      }
+      continue;
+    }
+
+    for (JoinHashTable::Row left_row : range) {
+      // Resolve hash collisions
+      if (!join_keys_equal(left_row, join.left_join_indices, projected_row, join.right_join_indices)) {
+        continue;
+      }
 
-    for (auto it = range.first; it != range.second; ++it) {
       // Combine left and right filtered rows
       std::vector<std::string> joined_row;
-      joined_row.insert(joined_row.end(), it->second.begin(), it->second.end());
+      for (size_t i = 0; i < left_row.size(); ++i) {
+        joined_row.emplace_back(left_row[i]);
+      }
       joined_row.insert(joined_row.end(), projected_row.begin(), projected_row.end());
 
       // Map headers to values
       std::unordered_map<std::string, std::string> row_map;
-      for (size_t i = 0; i < joined_headers.size(); ++i)
-        row_map[joined_headers[i]] = joined_row[i];
+      for (size_t i = 0; i < join.joined_headers.size(); ++i)
+        row_map[join.joined_headers[i]] = joined_row[i];
 
       std::string subject;
       std::string predicate;
@@ -491,7 +1176,7 @@ std::unordered_set<std::string> execute_complex_dependent(const fs::path& output
       unique_triple.insert(res);
     }
   }
-  return unique_triple;
+  collect_heavy_hitters(heavy_hitters, unique_triple);
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -500,8 +1185,8 @@ int execute_complex_with_graph(const fs::path& output_file_name,
                                const std::string& left_path, const std::string& right_path,
                                const std::string& left_name,
                                const std::string& right_name,
-                               const std::string& left_join_attr,
-                               const std::string& right_join_attr,
+                               const std::vector<std::string>& left_join_attrs,
+                               const std::vector<std::string>& right_join_attrs,
                                const std::string& base_uri,
                                const std::vector<std::string>& projected_attributes_left,
                                const std::vector<std::string>& projected_attributes_right,
@@ -509,9 +1194,9 @@ int execute_complex_with_graph(const fs::path& output_file_name,
                                const std::vector<std::string>& p_content,
                                const std::vector<std::string>& o_content,
                                const std::vector<std::string>& g_content,
+                               bool shared_scan,
                                const std::unordered_map<std::string, std::string>& data_map) {
   // Setup
-  std::string line;
   std::unordered_set<uint64_t> unique_hashes;
   size_t triple_counter = 0;
 
@@ -519,63 +1204,19 @@ int execute_complex_with_graph(const fs::path& output_file_name,
   size_t buffer_limit = 20000;
   std::string buffered_res;
 
-  // Open output file
-  fs::create_directories(output_file_name.parent_path());
-  std::ofstream outputFile(output_file_name, std::ios::app);
-  if (!outputFile) {
-    std::cerr << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
+  OutputWriter& output = output_writer(output_file_name);
 
   //////////////////////////////////////////////////////////////////////
-  // Open CSV files
-  auto left_file = open_from_map_or_file(data_map, left_path);
-  auto right_file = open_from_map_or_file(data_map, right_path);
-  if (!left_file || !right_file) {
-    std::cerr << "Error opening input files." << std::endl;
-    std::exit(1);
-  }
-
-  // Read header lines
-  std::string left_header_line, right_header_line;
-  std::getline(*left_file, left_header_line);
-  std::getline(*right_file, right_header_line);
-
-  // Build header mappings for left and right files.
-  auto [left_headers, left_header_idx] = build_header(left_header_line, left_name);
-  auto [right_headers, right_header_idx] = build_header(right_header_line, right_name);
-
-  auto left_proj_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
-  auto right_proj_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
-
-  int left_filtered_join_index = get_join_index(projected_attributes_left, left_name, left_join_attr);
-  int right_filtered_join_index = get_join_index(projected_attributes_right, right_name, right_join_attr);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
-
-  // Build hash table from left file (store only projected columns).
-  auto hash_table = build_hash_table(*left_file, left_proj_indices, left_filtered_join_index);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
-  // Prepare joined headers for output.
-  std::vector<std::string> joined_headers;
-  for (const auto& attr : projected_attributes_left) {
-    joined_headers.push_back(left_name + "_" + attr);
-  }
-  for (const auto& attr : projected_attributes_right) {
-    joined_headers.push_back(right_name + "_" + attr);
-  }
-
-  // Process right file
-  while (getline(*right_file, line)) {
-    auto split_line = split_csv_line(line, ',');
+  // Open inputs and build hash table from left file
+  JoinInputs join = prepare_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                                 projected_attributes_left, projected_attributes_right, shared_scan, data_map);
 
-    std::vector<std::string> projected_row;
-    ////// PROJECTION //////
-    for (int i : right_proj_indices) {
-      projected_row.push_back(split_line[i]);
-    }
+  std::vector<std::vector<std::string>> contents = {s_content, p_content, o_content, g_content};
+  HeavyHitterBatch heavy_hitters(join, contents, base_uri);
 
+  // Process right rows
+  std::vector<std::string> projected_row;
+  while (join.probe.next(projected_row)) {
     // Check for unwanted values
     bool skip = false;
     for (const auto& target : values_to_skip) {
@@ -594,19 +1235,37 @@ int execute_complex_with_graph(const fs::path& output_file_name,
       continue;
     }
 
-    std::string key = projected_row[right_filtered_join_index];
-    auto range = hash_table.equal_range(key);
+    uint64_t key_hash = combinedHash(projected_row, join.right_join_indices);
+    auto range = join.hash_table.equal_range(key_hash);
+
+    // Skewed keys are joined separately
+    if (const HeavyHitterKey* heavy_key = find_heavy_hitter(join, key_hash, projected_row); heavy_key != nullptr) {
+      heavy_hitters.add(*heavy_key, projected_row);
+      if (heavy_hitters.full()) {
+        triple_counter += heavy_hitters.flush(buffered_res);
+        ////// SERIALIZE //////
+        output.write(buffered_res);
+      }
+      continue;
+    }
+
+    for (JoinHashTable::Row left_row : range) {
+      // Resolve hash collisions
+      if (!join_keys_equal(left_row, join.left_join_indices, projected_row, join.right_join_indices)) {
+        continue;
+      }
 
-    for (auto it = range.first; it != range.second; ++it) {
       // Combine left and right filtered rows
       std::vector<std::string> joined_row;
-      joined_row.insert(joined_row.end(), it->second.begin(), it->second.end());
+      for (size_t i = 0; i < left_row.size(); ++i) {
+        joined_row.emplace_back(left_row[i]);
+      }
       joined_row.insert(joined_row.end(), projected_row.begin(), projected_row.end());
 
       // Map headers to values
       std::unordered_map<std::string, std::string> row_map;
-      for (size_t i = 0; i < joined_headers.size(); ++i)
-        row_map[joined_headers[i]] = joined_row[i];
+      for (size_t i = 0; i < join.joined_headers.size(); ++i)
+        row_map[join.joined_headers[i]] = joined_row[i];
 
       ////// CREATE //////
       std::string subject;
@@ -657,89 +1316,51 @@ int execute_complex_with_graph(const fs::path& output_file_name,
       if (write_cnt == buffer_limit) {
         write_cnt = 0;
         ////// SERIALIZE //////
-        outputFile << buffered_res;
-        buffered_res = "";
+        output.write(buffered_res);
       }
     }
   }
+  triple_counter += heavy_hitters.flush(buffered_res);
+
   ////// SERIALIZE //////
-  outputFile << buffered_res;
+  output.write(buffered_res);
 
   return triple_counter;
 }
 
 //////////////////////////////////////////////////////////////
 
-std::unordered_set<std::string> execute_complex_with_graph_dependent(const fs::path& output_file_name,
-                                                                     const std::string& left_path,
-                                                                     const std::string& right_path,
-                                                                     const std::string& left_name,
-                                                                     const std::string& right_name,
-                                                                     const std::string& left_join_attr,
-                                                                     const std::string& right_join_attr,
-                                                                     const std::string& base_uri,
-                                                                     const std::vector<std::string>& projected_attributes_left,
-                                                                     const std::vector<std::string>& projected_attributes_right,
-                                                                     const std::vector<std::string>& s_content,
-                                                                     const std::vector<std::string>& p_content,
-                                                                     const std::vector<std::string>& o_content,
-                                                                     const std::vector<std::string>& g_content,
-                                                                     std::unordered_set<std::string>& unique_triple,
-                                                                     const std::unordered_map<std::string, std::string>& data_map) {
+void execute_complex_with_graph_dependent(const fs::path& output_file_name,
+                                          const std::string& left_path,
+                                          const std::string& right_path,
+                                          const std::string& left_name,
+                                          const std::string& right_name,
+                                          const std::vector<std::string>& left_join_attrs,
+                                          const std::vector<std::string>& right_join_attrs,
+                                          const std::string& base_uri,
+                                          const std::vector<std::string>& projected_attributes_left,
+                                          const std::vector<std::string>& projected_attributes_right,
+                                          const std::vector<std::string>& s_content,
+                                          const std::vector<std::string>& p_content,
+                                          const std::vector<std::string>& o_content,
+                                          const std::vector<std::string>& g_content,
+                                          TripleCollector& unique_triple,
+                                          bool shared_scan,
+                                          const std::unordered_map<std::string, std::string>& data_map) {
   // Setup
-  std::string line;
   std::unordered_set<uint64_t> unique_hashes;
 
   //////////////////////////////////////////////////////////////////////
-  // Open CSV files
-  auto left_file = open_from_map_or_file(data_map, left_path);
-  auto right_file = open_from_map_or_file(data_map, right_path);
-  if (!left_file || !right_file) {
-    std::cerr << "Error opening input files." << std::endl;
-    std::exit(1);
-  }
+  // Open inputs and build hash table from left file
+  JoinInputs join = prepare_join(left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs,
+                                 projected_attributes_left, projected_attributes_right, shared_scan, data_map);
 
-  // Read header lines
-  std::string left_header_line, right_header_line;
-  std::getline(*left_file, left_header_line);
-  std::getline(*right_file, right_header_line);
-
-  // Build header mappings for left and right files.
-  auto [left_headers, left_header_idx] = build_header(left_header_line, left_name);
-  auto [right_headers, right_header_idx] = build_header(right_header_line, right_name);
-
-  auto left_proj_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
-  auto right_proj_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
-
-  int left_filtered_join_index = get_join_index(projected_attributes_left, left_name, left_join_attr);
-  int right_filtered_join_index = get_join_index(projected_attributes_right, right_name, right_join_attr);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
-
-  // Build hash table from left file using the left join index
-  auto hash_table = build_hash_table(*left_file, left_proj_indices, left_filtered_join_index);
-
-  //////////////////////////////////////////////////////////////////////////////////////////////////
-
-  // Prepare joined headers for output.
-  std::vector<std::string> joined_headers;
-  for (const auto& attr : projected_attributes_left) {
-    joined_headers.push_back(left_name + "_" + attr);
-  }
-  for (const auto& attr : projected_attributes_right) {
-    joined_headers.push_back(right_name + "_" + attr);
-  }
-
-  // Process right file
-  while (getline(*right_file, line)) {
-    auto split_line = split_csv_line(line, ',');
-
-    std::vector<std::string> projected_row;
-    ////// PROJECTION //////
-    for (int i : right_proj_indices) {
-      projected_row.push_back(split_line[i]);
-    }
+  std::vector<std::vector<std::string>> contents = {s_content, p_content, o_content, g_content};
+  HeavyHitterBatch heavy_hitters(join, contents, base_uri);
 
+  // Process right rows
+  std::vector<std::string> projected_row;
+  while (join.probe.next(projected_row)) {
     // Check for unwanted values
     bool skip = false;
     for (const auto& target : values_to_skip) {
@@ -758,19 +1379,35 @@ std::unordered_set<std::string> execute_complex_with_graph_dependent(const fs::p
       continue;
     }
 
-    std::string key = projected_row[right_filtered_join_index];
-    auto range = hash_table.equal_range(key);
+    uint64_t key_hash = combinedHash(projected_row, join.right_join_indices);
+    auto range = join.hash_table.equal_range(key_hash);
+
+    // Skewed keys are joined separately
+    if (const HeavyHitterKey* heavy_key = find_heavy_hitter(join, key_hash, projected_row); heavy_key != nullptr) {
+      heavy_hitters.add(*heavy_key, projected_row);
+      if (heavy_hitters.full()) {
+        collect_heavy_hitters(heavy_hitters, unique_triple);
+      }
+      continue;
+    }
+
+    for (JoinHashTable::Row left_row : range) {
+      // Resolve hash collisions
+      if (!join_keys_equal(left_row, join.left_join_indices, projected_row, join.right_join_indices)) {
+        continue;
+      }
 
-    for (auto it = range.first; it != range.second; ++it) {
       // Combine left and right filtered rows
       std::vector<std::string> joined_row;
-      joined_row.insert(joined_row.end(), it->second.begin(), it->second.end());
+      for (size_t i = 0; i < left_row.size(); ++i) {
+        joined_row.emplace_back(left_row[i]);
+      }
       joined_row.insert(joined_row.end(), projected_row.begin(), projected_row.end());
 
       // Map headers to values
       std::unordered_map<std::string, std::string> row_map;
-      for (size_t i = 0; i < joined_headers.size(); ++i)
-        row_map[joined_headers[i]] = joined_row[i];
+      for (size_t i = 0; i < join.joined_headers.size(); ++i)
+        row_map[join.joined_headers[i]] = joined_row[i];
 
       ////// CREATE //////
       std::string subject;
@@ -816,7 +1453,218 @@ std::unordered_set<std::string> execute_complex_with_graph_dependent(const fs::p
       unique_triple.insert(res);
     }
   }
-  return unique_triple;
+  collect_heavy_hitters(heavy_hitters, unique_triple);
+}
+
+//////////////////////////////////////////////////////////////
+// Semi join: emits one triple per left row whose join key exists in the right input.
+// Used for eliminated joins where all terms are generated from the left row.
+// If unique_triple is null the triples are written to the output file.
+size_t execute_semi_join(const fs::path& output_file_name,
+                         const std::string& left_path,
+                         const std::string& right_path,
+                         const std::string& left_name,
+                         const std::string& right_name,
+                         const std::vector<std::string>& left_join_attrs,
+                         const std::vector<std::string>& right_join_attrs,
+                         const std::string& base_uri,
+                         const std::vector<std::string>& projected_attributes_left,
+                         const std::vector<std::string>& projected_attributes_right,
+                         const std::vector<std::string>& s_content,
+                         const std::vector<std::string>& p_content,
+                         const std::vector<std::string>& o_content,
+                         const std::vector<std::string>& g_content,
+                         TripleCollector* unique_triple,
+                         const std::unordered_map<std::string, std::string>& data_map) {
+  // Setup
+  std::string line;
+  std::unordered_set<uint64_t> unique_hashes;
+  size_t triple_counter = 0;
+
+  size_t write_cnt = 0;
+  size_t buffer_limit = 20000;
+  std::string buffered_res;
+
+  OutputWriter* output = unique_triple == nullptr ? &output_writer(output_file_name) : nullptr;
+
+  //////////////////////////////////////////////////////////////////////
+  // Open CSV files
+  auto left_file = open_from_map_or_file(data_map, left_path);
+  auto right_file = open_from_map_or_file(data_map, right_path);
+  if (!left_file || !right_file) {
+    std::cerr << "Error opening input files." << std::endl;
+    std::exit(1);
+  }
+
+  // Read header lines
+  std::string left_header_line, right_header_line;
+  std::getline(*left_file, left_header_line);
+  std::getline(*right_file, right_header_line);
+
+  // Build header mappings for left and right files.
+  auto [left_headers, left_header_idx] = build_header(left_header_line, left_name);
+  auto [right_headers, right_header_idx] = build_header(right_header_line, right_name);
+
+  auto left_proj_indices = get_projected_indices(projected_attributes_left, left_name, left_header_idx);
+  auto right_proj_indices = get_projected_indices(projected_attributes_right, right_name, right_header_idx);
+
+  auto left_join_indices = get_join_indices(projected_attributes_left, left_name, left_join_attrs);
+  auto right_join_indices = get_join_indices(projected_attributes_right, right_name, right_join_attrs);
+
+  //////////////////////////////////////////////////////////////////////////////////////////////////
+  // Collect the keys of the right file. Only the join columns are stored, in join order,
+  // they are compared on probe to resolve hash collisions.
+  std::unordered_multimap<uint64_t, std::vector<std::string>> existing_keys;
+  existing_keys.reserve(1024 * 1024);
+  std::vector<int> key_indices(right_join_indices.size());
+  std::iota(key_indices.begin(), key_indices.end(), 0);
+
+  while (getline(*right_file, line)) {
+    auto split_line = split_csv_line(line, ',');
+
+    std::vector<std::string> projected_row;
+    for (int i : right_proj_indices) {
+      projected_row.push_back(split_line[i]);
+    }
+
+    bool skip = false;
+    for (const auto& target : values_to_skip) {
+      if (std::any_of(projected_row.begin(), projected_row.end(), [&target](const std::string& s) { return s == target; })) {
+        skip = true;
+        break;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+
+    std::vector<std::string> key;
+    key.reserve(right_join_indices.size());
+    for (int i : right_join_indices) {
+      key.push_back(projected_row[i]);
+    }
+    uint64_t key_hash = combinedHash(projected_row, right_join_indices);
+    auto range = existing_keys.equal_range(key_hash);
+    bool known = std::any_of(range.first, range.second, [&](const auto& entry) { return entry.second == key; });
+    if (!known) {
+      existing_keys.emplace(key_hash, std::move(key));
+    }
+  }
+
+  //////////////////////////////////////////////////////////////////////////////////////////////////
+  // Process left file
+  while (getline(*left_file, line)) {
+    auto split_line = split_csv_line(line, ',');
+
+    std::vector<std::string> projected_row;
+    ////// PROJECTION //////
+    for (int i : left_proj_indices) {
+      projected_row.push_back(split_line[i]);
+    }
+
+    // Check for unwanted values
+    bool skip = false;
+    for (const auto& target : values_to_skip) {
+      if (std::any_of(projected_row.begin(), projected_row.end(), [&target](const std::string& s) { return s == target; })) {
+        skip = true;
+        break;
+      }
+    }
+    if (skip) {
+      continue;
+    }
+
+    // Eliminate duplicates using hash
+    uint64_t hash = combinedHash(projected_row);
+    if (!unique_hashes.insert(hash).second) {
+      continue;
+    }
+
+    // Existence check
+    auto range = existing_keys.equal_range(combinedHash(projected_row, left_join_indices));
+    bool exists = std::any_of(range.first, range.second, [&](const auto& entry) {
+      return join_keys_equal(entry.second, key_indices, projected_row, left_join_indices);
+    });
+    if (!exists) {
+      continue;
+    }
+
+    // Map headers to values
+    std::unordered_map<std::string, std::string> row_map;
+    for (size_t i = 0; i < projected_attributes_left.size(); ++i)
+      row_map[left_name + "_" + projected_attributes_left[i]] = projected_row[i];
+
+    ////// CREATE //////
+    std::string subject;
+    std::string predicate;
+    std::string object;
+    std::string graph;
+
+    try {
+      // SUBJECT
+      if (s_content[1] == "preformatted") {
+        subject = s_content[0];
+      } else {
+        subject = create_operator(s_content[0], s_content[1], s_content[2], "", "", base_uri, row_map);
+      }
+      // PREDICATE
+      if (p_content[1] == "preformatted") {
+        predicate = p_content[0];
+      } else {
+        predicate = create_operator(p_content[0], p_content[1], p_content[2], "", "", base_uri, row_map);
+      }
+      // OBJECT
+      if (o_content[1] == "preformatted") {
+        object = o_content[0];
+      } else {
+        object = create_operator(o_content[0], o_content[1], o_content[2], o_content[3], o_content[4], base_uri, row_map);
+      }
+      // GRAPH
+      if (!g_content.empty()) {
+        if (g_content[1] == "preformatted") {
+          graph = g_content[0];
+        } else {
+          graph = create_operator(g_content[0], g_content[1], g_content[2], "", "", base_uri, row_map);
+        }
+      }
+    } catch (const std::runtime_error& e) {
+      if (continue_on_error == false) {
+        std::cout << e.what() << std::endl;
+        std::exit(1);
+      } else {
+        continue;
+      }
+    }
+
+    std::string res;
+    if (g_content.empty()) {
+      res = subject + " " + predicate + " " + object + " .\n";
+    } else {
+      res = subject + " " + predicate + " " + object + " " + graph + " .\n";
+    }
+
+    if (unique_triple != nullptr) {
+      unique_triple->insert(res);
+      continue;
+    }
+
+    triple_counter++;
+    buffered_res += res;
+    write_cnt++;
+
+    if (write_cnt == buffer_limit) {
+      write_cnt = 0;
+      ////// SERIALIZE //////
+      output->write(buffered_res);
+    }
+  }
+
+  ////// SERIALIZE //////
+  if (output != nullptr) {
+    output->write(buffered_res);
+  }
+
+  return triple_counter;
 }
 
 //////////////////////////////////////////////////////////////
@@ -843,9 +1691,12 @@ size_t standalone_complex_mapping(const std::string& information, const std::uno
   std::vector<std::string> projected_attributes_right = split_by_substring(split_info_second[2], "===");
   std::string right_name = split_info_second[3];
 
-  std::vector<std::string> join_mapping = split_by_substring(split_info_third[1], "===");
-  std::string left_join_attr = join_mapping[0];
-  std::string right_join_attr = join_mapping[1];
+  std::vector<std::string> left_join_attrs;
+  std::vector<std::string> right_join_attrs;
+  parse_join_conditions(split_info_third, left_join_attrs, right_join_attrs);
+  std::string join_operator = split_info_third[0];
+  // A self join reads its single source once for both sides of the join
+  bool shared_scan = join_operator == "self_join";
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   size_t generated_triple = 0;
@@ -865,9 +1716,16 @@ size_t standalone_complex_mapping(const std::string& information, const std::uno
       } else if (s_content[1] == "preformatted" && p_content[1] == "preformatted" && o_content[1] == "preformatted") {
         handle_constant_preformatted(s_content, p_content, o_content, g_content, output_file_name);
         generated_triple = 1;
+      } else if (join_operator == "semi_join") {
+        generated_triple = execute_semi_join(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                             projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, nullptr, data_map);
+      } else if (Scheduler::current() != nullptr) {
+        // Threaded execution overlaps the stages of the join
+        generated_triple = execute_complex_pipelined(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                                     projected_attributes_left, projected_attributes_right, {s_content, p_content, o_content}, shared_scan, data_map);
       } else {
-        generated_triple = execute_complex(output_file_name, left_path, right_path, left_name, right_name, left_join_attr, right_join_attr, base_uri,
-                                           projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, data_map);
+        generated_triple = execute_complex(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                           projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, shared_scan, data_map);
       }
     } else {
       // Handle with graph
@@ -879,10 +1737,16 @@ size_t standalone_complex_mapping(const std::string& information, const std::uno
       } else if (s_content[1] == "preformatted" && p_content[1] == "preformatted" && o_content[1] == "preformatted" && g_content[1] == "preformatted") {
         handle_constant_preformatted(s_content, p_content, o_content, g_content, output_file_name);
         generated_triple = 1;
+      } else if (join_operator == "semi_join") {
+        generated_triple = execute_semi_join(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                             projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, nullptr, data_map);
+      } else if (Scheduler::current() != nullptr) {
+        generated_triple = execute_complex_pipelined(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                                     projected_attributes_left, projected_attributes_right, {s_content, p_content, o_content, g_content}, shared_scan, data_map);
       } else {
         // If not constant handle normal
-        generated_triple = execute_complex_with_graph(output_file_name, left_path, right_path, left_name, right_name, left_join_attr, right_join_attr, base_uri,
-                                                      projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, data_map);
+        generated_triple = execute_complex_with_graph(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                                      projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, shared_scan, data_map);
       }
     }
   } catch (const std::runtime_error& e) {
@@ -898,7 +1762,7 @@ size_t standalone_complex_mapping(const std::string& information, const std::uno
   return generated_triple;
 }
 
-std::unordered_set<std::string> dependent_complex_mapping(const std::string& information, std::unordered_set<std::string>& unique_triple, const std::unordered_map<std::string, std::string>& data_map) {
+void dependent_complex_mapping(const std::string& information, TripleCollector& unique_triple, const std::unordered_map<std::string, std::string>& data_map) {
   // Extract relevant parts
   std::vector<std::string> split_info = split_by_substring(information, "\n");
   if (split_info.size() != 7) {
@@ -922,9 +1786,12 @@ std::unordered_set<std::string> dependent_complex_mapping(const std::string& inf
   std::vector<std::string> projected_attributes_right = split_by_substring(split_info_second[2], "===");
   std::string right_name = split_info_second[3];
 
-  std::vector<std::string> join_mapping = split_by_substring(split_info_third[1], "===");
-  std::string left_join_attr = join_mapping[0];
-  std::string right_join_attr = join_mapping[1];
+  std::vector<std::string> left_join_attrs;
+  std::vector<std::string> right_join_attrs;
+  parse_join_conditions(split_info_third, left_join_attrs, right_join_attrs);
+  std::string join_operator = split_info_third[0];
+  // A self join reads its single source once for both sides of the join
+  bool shared_scan = join_operator == "self_join";
 
   ////////////////////////////////////////////////////////////////////////////////////////////////////////////////
   size_t generated_triple = 0;
@@ -943,9 +1810,12 @@ std::unordered_set<std::string> dependent_complex_mapping(const std::string& inf
       } else if (s_content[1] == "preformatted" && p_content[1] == "preformatted" && o_content[1] == "preformatted") {
         handle_constant_preformatted_dependent(s_content, p_content, o_content, g_content, output_file_name, unique_triple);
         generated_triple = 1;
+      } else if (join_operator == "semi_join") {
+        execute_semi_join(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                          projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, &unique_triple, data_map);
       } else {
-        unique_triple = execute_complex_dependent(output_file_name, left_path, right_path, left_name, right_name, left_join_attr, right_join_attr, base_uri,
-                                                  projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, unique_triple, data_map);
+        execute_complex_dependent(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                  projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, unique_triple, shared_scan, data_map);
       }
     } else {
       // Handle with graph //
@@ -956,9 +1826,12 @@ std::unordered_set<std::string> dependent_complex_mapping(const std::string& inf
       } else if (s_content[1] == "preformatted" && p_content[1] == "preformatted" && o_content[1] == "preformatted") {
         handle_constant_preformatted_dependent(s_content, p_content, o_content, g_content, output_file_name, unique_triple);
         generated_triple = 1;
+      } else if (join_operator == "semi_join") {
+        execute_semi_join(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                          projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, &unique_triple, data_map);
       } else {
-        unique_triple = execute_complex_with_graph_dependent(output_file_name, left_path, right_path, left_name, right_name, left_join_attr, right_join_attr, base_uri,
-                                                             projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, unique_triple, data_map);
+        execute_complex_with_graph_dependent(output_file_name, left_path, right_path, left_name, right_name, left_join_attrs, right_join_attrs, base_uri,
+                                             projected_attributes_left, projected_attributes_right, s_content, p_content, o_content, g_content, unique_triple, shared_scan, data_map);
       }
     }
   } catch (const std::runtime_error& e) {
@@ -970,6 +1843,4 @@ std::unordered_set<std::string> dependent_complex_mapping(const std::string& inf
     std::cout << "Unknown exception caught!" << std::endl;
     std::exit(1);
   }
-
-  return unique_triple;
 }
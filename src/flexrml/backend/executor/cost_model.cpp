@@ -0,0 +1,248 @@
+#include "cost_model.h"
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <sstream>
+#include <unordered_set>
+
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+// Rows read from every source to estimate its statistics
+constexpr size_t sample_rows = 1000;
+
+// Relative costs per row or per triple
+constexpr double cost_per_byte = 0.02;        // reading and tokenizing
+constexpr double cost_per_row = 1.0;
+constexpr double cost_per_projected = 0.2;    // projection and duplicate hash per attribute
+constexpr double cost_per_triple = 0.5;       // concatenating and writing a triple
+constexpr double cost_dependent_dedup = 0.5;  // fingerprint of a triple in a dependent partition
+constexpr double cost_build_row = 0.5;        // inserting into the join hash table
+constexpr double cost_probe_row = 0.3;        // hash table lookup
+
+// Bytes of a generated N-Triples line, IRIs with a short literal or IRI object
+constexpr double bytes_per_triple = 120;
+
+// Cost of generating a term, templates with more references and IRIs are more expensive
+static double term_cost(const std::string& content_str) {
+  std::vector<std::string> content = split_by_substring(content_str, "===");
+  if (content.size() < 3) {
+    return 0.05;
+  }
+  const std::string& term_map_type = content[1];
+  double cost = 0.05;
+  if (term_map_type == "template") {
+    cost = 1.0 + 0.5 * extract_substrings(content[0]).size();
+  } else if (term_map_type == "reference") {
+    cost = 0.5;
+  }
+  if (term_map_type != "preformatted" && content[2] == "iri") {
+    cost += 0.5;  // IRI safe encoding
+  }
+  return cost;
+}
+
+// Cost of one triple of the format line
+static double triple_cost(const std::string& format_line) {
+  std::vector<std::string> terms = split_by_substring(format_line, "|||");
+  double cost = cost_per_triple;
+  for (size_t i = 1; i < terms.size(); ++i) {
+    cost += term_cost(terms[i]);
+  }
+  return cost;
+}
+
+const CostModel::SourceStats& CostModel::source_stats(const std::string& path) {
+  if (auto it = sources_.find(path); it != sources_.end()) {
+    return it->second;
+  }
+
+  SourceStats& stats = sources_[path];
+  std::unique_ptr<std::istream> input;
+  double total_bytes = 0;
+  if (auto it = data_map_.find(path); it != data_map_.end()) {
+    input = std::make_unique<std::istringstream>(it->second);
+    total_bytes = it->second.size();
+  } else {
+    auto file = std::make_unique<std::ifstream>(path);
+    if (!file->is_open()) {
+      // Missing sources are reported by the executor
+      return stats;
+    }
+    std::error_code error;
+    total_bytes = static_cast<double>(fs::file_size(path, error));
+    input = std::move(file);
+  }
+
+  std::string line;
+  if (!std::getline(*input, line)) {
+    stats.complete = true;
+    return stats;
+  }
+  stats.header = split_csv_line(line, ',');
+  double data_bytes = total_bytes - (line.size() + 1);
+
+  double sampled_bytes = 0;
+  while (stats.sample.size() < sample_rows && std::getline(*input, line)) {
+    sampled_bytes += line.size() + 1;
+    stats.sample.push_back(split_csv_line(line, ','));
+  }
+  stats.complete = input->peek() == EOF;
+
+  size_t sampled = stats.sample.size();
+  stats.bytes_per_row = sampled > 0 ? sampled_bytes / sampled : 0;
+  if (stats.complete || stats.bytes_per_row == 0) {
+    stats.rows = sampled;
+  } else {
+    stats.rows = std::max<double>(sampled, data_bytes / stats.bytes_per_row);
+  }
+  return stats;
+}
+
+// Estimated number of distinct values of the attributes in the whole source
+double CostModel::distinct_keys(const SourceStats& stats, const std::vector<std::string>& attributes) {
+  if (stats.sample.empty()) {
+    return 1;
+  }
+  std::vector<int> indices;
+  for (const auto& attribute : attributes) {
+    auto it = std::find(stats.header.begin(), stats.header.end(), attribute);
+    if (it == stats.header.end()) {
+      return std::max(1.0, stats.rows);  // unknown attribute, assume unique keys
+    }
+    indices.push_back(static_cast<int>(std::distance(stats.header.begin(), it)));
+  }
+
+  std::unordered_set<std::string> keys;
+  for (const auto& row : stats.sample) {
+    std::string key;
+    for (int index : indices) {
+      if (index < static_cast<int>(row.size())) {
+        key += row[index];
+      }
+      key += '\x1f';
+    }
+    keys.insert(key);
+  }
+  if (stats.complete) {
+    return std::max<double>(1, keys.size());
+  }
+  // Extrapolate the share of distinct keys in the sample
+  return std::max(1.0, stats.rows * keys.size() / stats.sample.size());
+}
+
+CostModel::PlanCost CostModel::plan_cost(const std::string& plan, bool dependent) {
+  PlanCost cost;
+  std::vector<std::string> lines = split_by_substring(plan, "\n");
+  double per_triple = dependent ? cost_dependent_dedup : 0;
+
+  auto scan_cost = [](const SourceStats& stats) {
+    return stats.rows * (cost_per_row + stats.bytes_per_row * cost_per_byte);
+  };
+
+  if (lines.size() == 5) {
+    std::vector<std::string> scan = split_by_substring(lines[0], "|||");
+    std::vector<std::string> format = split_by_substring(lines[1], "|||");
+    if (scan.size() < 3 || format.size() < 4) {
+      return cost;
+    }
+    const SourceStats& stats = source_stats(scan[1]);
+    double projected = split_by_substring(scan[2], "===").size();
+    cost.scan = scan_cost(stats);
+    cost.work = stats.rows * (projected * cost_per_projected + triple_cost(lines[1]) + per_triple);
+    cost.triples = stats.rows;
+  } else if (lines.size() == 7) {
+    std::vector<std::string> build = split_by_substring(lines[0], "|||");
+    std::vector<std::string> probe = split_by_substring(lines[1], "|||");
+    std::vector<std::string> join = split_by_substring(lines[2], "|||");
+    if (build.size() < 4 || probe.size() < 4 || join.empty()) {
+      return cost;
+    }
+    const SourceStats& build_stats = source_stats(build[1]);
+    const SourceStats& probe_stats = source_stats(probe[1]);
+
+    // Join attributes carry the name of their side as prefix
+    std::vector<std::string> build_attrs;
+    std::vector<std::string> probe_attrs;
+    for (size_t i = 1; i < join.size(); ++i) {
+      std::vector<std::string> condition = split_by_substring(join[i], "===");
+      if (condition.size() != 2) {
+        continue;
+      }
+      build_attrs.push_back(condition[0].substr(std::min(condition[0].size(), build[3].size() + 1)));
+      probe_attrs.push_back(condition[1].substr(std::min(condition[1].size(), probe[3].size() + 1)));
+    }
+
+    // Matches per probe row, the semi join emits at most one triple per probe row
+    double fan_out = build_stats.rows / distinct_keys(build_stats, build_attrs);
+    if (join[0] == "semi_join") {
+      fan_out = 1;
+    }
+    double output = probe_stats.rows * fan_out;
+
+    double build_projected = split_by_substring(build[2], "===").size();
+    double probe_projected = split_by_substring(probe[2], "===").size();
+    cost.scan = scan_cost(probe_stats);
+    if (join[0] != "self_join" || build[1] != probe[1]) {
+      cost.scan += scan_cost(build_stats);
+    }
+    cost.work = build_stats.rows * (build_projected * cost_per_projected + cost_build_row) +
+                probe_stats.rows * (probe_projected * cost_per_projected + cost_probe_row) +
+                output * (triple_cost(lines[3]) + per_triple);
+    cost.triples = output;
+  }
+  return cost;
+}
+
+double CostModel::output_bytes(const std::vector<std::string>& partition) {
+  double triples = 0;
+  for (const auto& plan : partition) {
+    triples += plan_cost(plan, false).triples;
+  }
+  return triples * bytes_per_triple;
+}
+
+double CostModel::self_join_buffer_bytes(const std::string& plan) {
+  std::vector<std::string> lines = split_by_substring(plan, "\n");
+  if (lines.size() != 7) {
+    return 0;
+  }
+  std::vector<std::string> probe = split_by_substring(lines[1], "|||");
+  std::vector<std::string> join = split_by_substring(lines[2], "|||");
+  if (probe.size() < 3 || join.empty() || join[0] != "self_join") {
+    return 0;
+  }
+
+  // A row is a vector of the projected values, their text is a share of the line
+  const SourceStats& stats = source_stats(probe[1]);
+  double projected = split_by_substring(probe[2], "===").size();
+  double columns = std::max<double>(1, stats.header.size());
+  double row_bytes = sizeof(std::vector<std::string>) + projected * sizeof(std::string) +
+                     stats.bytes_per_row * std::min(1.0, projected / columns);
+  return stats.rows * row_bytes;
+}
+
+double CostModel::partition_cost(const std::vector<std::string>& partition, bool fused_scan) {
+  bool dependent = partition.size() > 1 && !fused_scan;
+  double scan = 0;
+  double work = 0;
+  for (const auto& plan : partition) {
+    PlanCost cost = plan_cost(plan, dependent);
+    // A fused scan reads its source once
+    scan = fused_scan ? std::max(scan, cost.scan) : scan + cost.scan;
+    work += cost.work;
+  }
+  return scan + work;
+}
+
+std::vector<size_t> lpt_order(const std::vector<double>& costs) {
+  std::vector<size_t> order(costs.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&costs](size_t a, size_t b) { return costs[a] > costs[b]; });
+  return order;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Estimated run time of plans, in arbitrary units. Sources are sampled once to estimate
+// their row count and row width, joins additionally estimate the fan-out of the build side.
+class CostModel {
+ public:
+  explicit CostModel(const std::unordered_map<std::string, std::string>& data_map) : data_map_(data_map) {}
+
+  // Cost of a partition. Plans of a fused scan share the scan of their source,
+  // plans of dependent partitions pay for the cross-plan duplicate elimination.
+  double partition_cost(const std::vector<std::string>& partition, bool fused_scan);
+
+  // Estimated N-Triples bytes written by a partition, duplicates not removed.
+  double output_bytes(const std::vector<std::string>& partition);
+
+  // Estimated memory of the probe rows a self join buffers while it builds its hash table,
+  // 0 for other plans.
+  double self_join_buffer_bytes(const std::string& plan);
+
+ private:
+  struct SourceStats {
+    double rows = 0;
+    double bytes_per_row = 0;
+    bool complete = false;  // the sample covers the whole source
+    std::vector<std::string> header;
+    std::vector<std::vector<std::string>> sample;
+  };
+
+  struct PlanCost {
+    double scan = 0;  // reading and tokenizing the sources
+    double work = 0;  // projection, joins and triple generation
+    double triples = 0;
+  };
+
+  PlanCost plan_cost(const std::string& plan, bool dependent);
+  const SourceStats& source_stats(const std::string& path);
+  double distinct_keys(const SourceStats& stats, const std::vector<std::string>& attributes);
+
+  const std::unordered_map<std::string, std::string>& data_map_;
+  std::unordered_map<std::string, SourceStats> sources_;
+};
+
+// Indices of the partitions, most expensive first (longest processing time first).
+std::vector<size_t> lpt_order(const std::vector<double>& costs);
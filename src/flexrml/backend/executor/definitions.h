@@ -4,4 +4,14 @@
 #include <vector>
 
 inline std::vector<std::string> values_to_skip = {"NULL", ""};
-inline bool continue_on_error = false;
\ No newline at end of file
+inline bool continue_on_error = false;
+// Directory of persisted join indices, empty if disabled
+inline std::string join_index_dir = "";
+// Start partitions in order of their estimated cost, most expensive first
+inline bool heuristic_ordering = true;
+// Write every partition into its own shard of the output file with a manifest
+inline bool sharded_output = false;
+// Concatenate the shards into the output file at the end of the execution
+inline bool concatenate_output_shards = false;
+// Store the triples kept in memory with a term dictionary
+inline bool result_dictionary = false;
@@ -1,10 +1,8 @@
 #include <atomic>
-#include <condition_variable>
 #include <fstream>
 #include <functional>
 #include <iostream>
 #include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <unordered_set>
@@ -12,74 +10,18 @@
 #include <algorithm>
 
 #include "complex_executor.h"
+#include "cost_model.h"
 #include "definitions.h"
+#include "output_writer.h"
+#include "resource_manager.h"
+#include "result_store.h"
+#include "scheduler.h"
+#include "sharded_output.h"
 #include "simple_executor.h"
 #include "utils.h"
 
 static std::string final_result;
 
-class ThreadPool {
- public:
-  ThreadPool(size_t numThreads);
-  ~ThreadPool();
-
-  void enqueue(std::function<void()> task);
-  void shutdown();
-
- private:
-  std::vector<std::thread> workers;
-  std::queue<std::function<void()>> tasks;
-
-  std::mutex queueMutex;
-  std::condition_variable condition;
-  bool stop;
-  bool shutdownCalled;
-};
-
-ThreadPool::ThreadPool(size_t numThreads) : stop(false), shutdownCalled(false) {
-  for (size_t i = 0; i < numThreads; ++i) {
-    workers.emplace_back([this] {
-      for (;;) {
-        std::function<void()> task;
-        {
-          std::unique_lock<std::mutex> lock(this->queueMutex);
-          this->condition.wait(
-              lock, [this] { return this->stop || !this->tasks.empty(); });
-          if (this->stop && this->tasks.empty()) return;
-          task = std::move(this->tasks.front());
-          this->tasks.pop();
-        }
-        task();
-      }
-    });
-  }
-}
-
-void ThreadPool::enqueue(std::function<void()> task) {
-  {
-    std::unique_lock<std::mutex> lock(queueMutex);
-    tasks.push(std::move(task));
-  }
-  condition.notify_one();
-}
-
-void ThreadPool::shutdown() {
-  {
-    std::unique_lock<std::mutex> lock(queueMutex);
-    if (shutdownCalled) return;
-    stop = true;
-    shutdownCalled = true;
-  }
-  condition.notify_all();
-  for (std::thread& worker : workers) {
-    if (worker.joinable()) {
-      worker.join();
-    }
-  }
-}
-
-ThreadPool::~ThreadPool() { shutdown(); }
-
 ///////////////////////////////////////////////////////////////
 void clear_output_file(const std::string& output_file_path) {
   std::ofstream file(output_file_path, std::ios::out | std::ios::trunc);
@@ -107,12 +49,213 @@ void split_to_kv_into(std::unordered_map<std::string, std::string>& out,
     out[key] = value; // overwrites if key already exists
 }
 
+//////////////////////////////////////////////////////////////
+// Function to apply executor options, given as key===value|||key===value
+void apply_options(const std::string& options) {
+  join_index_dir = "";
+  heuristic_ordering = true;
+  sharded_output = false;
+  concatenate_output_shards = false;
+  result_dictionary = false;
+  ResourceSettings resource_settings;
+  OutputSettings output_settings;
+
+  for (const auto& [key, value] : parse_options(options)) {
+    if (key == "join_index_dir") {
+      join_index_dir = value;
+    } else if (key == "heuristic_ordering") {
+      heuristic_ordering = value == "true";
+    } else if (key == "sharded_output") {
+      sharded_output = value == "true";
+    } else if (key == "concatenate_shards") {
+      concatenate_output_shards = value == "true";
+    } else if (key == "result_dictionary") {
+      result_dictionary = value == "true";
+    } else if (!parse_resource_option(key, value, resource_settings) && !parse_output_option(key, value, output_settings)) {
+      std::cout << "Error: Unknown executor option. Got: " << key << std::endl;
+      std::exit(1);
+    }
+  }
+  ResourceManager::instance().configure(resource_settings);
+  configure_output(output_settings);
+}
+
+//////////////////////////////////////////////////////////////
+// Function to execute the plans of a dependent partition. The plans share a fingerprint set
+// to remove duplicate triples across the partition and write into their own buffer, unless
+// the duplicates are removed by the sorted output. Inside the scheduler the plans run concurrently.
+size_t execute_dependent_partition(const std::vector<std::string>& partition, std::string& buffer, Scheduler* scheduler,
+                                   const std::unordered_map<std::string, std::string>& data_map, bool deduplicate) {
+  if (partition.empty()) {
+    return 0;
+  }
+
+  ConcurrentFingerprintSet fingerprints;
+  std::vector<TripleCollector> collectors;
+  collectors.reserve(partition.size());
+  for (size_t i = 0; i < partition.size(); ++i) {
+    collectors.emplace_back(deduplicate ? &fingerprints : nullptr);
+  }
+
+  // Simple plans reading the same source share one scan
+  std::vector<std::vector<size_t>> units;
+  std::unordered_map<std::string, size_t> unit_of_source;
+  for (size_t i = 0; i < partition.size(); ++i) {
+    std::string source = simple_plan_source(partition[i]);
+    if (source.empty()) {
+      units.push_back({i});
+    } else if (auto it = unit_of_source.find(source); it != unit_of_source.end()) {
+      units[it->second].push_back(i);
+    } else {
+      unit_of_source[source] = units.size();
+      units.push_back({i});
+    }
+  }
+
+  auto run_unit = [&](size_t u) {
+    const std::vector<size_t>& unit = units[u];
+    if (unit.size() > 1) {
+      std::vector<std::string> plans;
+      std::vector<TripleCollector*> unit_collectors;
+      for (size_t i : unit) {
+        plans.push_back(partition[i]);
+        unit_collectors.push_back(&collectors[i]);
+      }
+      fused_dependent_simple_mapping(plans, unit_collectors, data_map);
+      return;
+    }
+
+    const std::string& plan_str = partition[unit[0]];
+    int plan_size = split_by_substring(plan_str, "\n").size();
+    if (plan_size == 5) {
+      dependent_simple_mapping(plan_str, collectors[unit[0]], data_map);
+    } else if (plan_size == 7) {
+      dependent_complex_mapping(plan_str, collectors[unit[0]], data_map);
+    }
+  };
+
+  if (scheduler != nullptr) {
+    TaskGroup plans(*scheduler);
+    for (size_t u = 1; u < units.size(); ++u) {
+      plans.run([&run_unit, u] { run_unit(u); });
+    }
+    run_unit(0);
+    plans.wait();
+  } else {
+    for (size_t u = 0; u < units.size(); ++u) {
+      run_unit(u);
+    }
+  }
+
+  // serialize //
+  size_t total_size = 0;
+  size_t generated_triple = 0;
+  for (const auto& collector : collectors) {
+    total_size += collector.buffer().size();
+    generated_triple += collector.size();
+  }
+  buffer.reserve(total_size);
+  for (const auto& collector : collectors) {
+    buffer += collector.buffer();
+  }
+  return generated_triple;
+}
+
+//////////////////////////////////////////////////////////////
+// Function to merge partitions consisting of a single simple plan that read the same source.
+// The merged partition is executed as one fused scan, marked in the returned flags.
+std::vector<bool> fuse_shared_scans(std::vector<std::vector<std::string>>& partitions, bool keep_in_memory) {
+  std::vector<std::vector<std::string>> fused_partitions;
+  std::vector<bool> fused_scan;
+  std::unordered_map<std::string, size_t> partition_of_source;
+
+  for (auto& partition : partitions) {
+    std::string source;
+    if (partition.size() == 1 && !keep_in_memory) {
+      source = simple_plan_source(partition[0]);
+    }
+    if (!source.empty()) {
+      if (auto it = partition_of_source.find(source); it != partition_of_source.end()) {
+        fused_partitions[it->second].push_back(partition[0]);
+        fused_scan[it->second] = true;
+        continue;
+      }
+      partition_of_source[source] = fused_partitions.size();
+    }
+    fused_partitions.push_back(std::move(partition));
+    fused_scan.push_back(false);
+  }
+
+  partitions = std::move(fused_partitions);
+  return fused_scan;
+}
+
+// Memory the buffered probe rows of a self join may take
+constexpr double self_join_buffer_limit = 256.0 * 1024 * 1024;
+
+//////////////////////////////////////////////////////////////
+// Function to turn self joins back into hash joins when the probe rows they buffer would not
+// fit into memory. The hash join reads the source a second time and streams the probe side.
+void limit_self_joins(std::vector<std::vector<std::string>>& partitions,
+                      const std::unordered_map<std::string, std::string>& data_map) {
+  CostModel cost_model(data_map);
+  for (auto& partition : partitions) {
+    for (auto& plan : partition) {
+      if (cost_model.self_join_buffer_bytes(plan) <= self_join_buffer_limit) {
+        continue;
+      }
+      // The join operator starts the third line
+      size_t join_line = plan.find('\n', plan.find('\n') + 1) + 1;
+      plan.replace(join_line, std::string("self_join").size(), "hash_join");
+    }
+  }
+}
+
+//////////////////////////////////////////////////////////////
+// Function to order partitions by their estimated cost, most expensive first. Started in this
+// order the scheduler runs them longest processing time first, so no large partition is left
+// running alone at the end.
+void order_partitions(std::vector<std::vector<std::string>>& partitions, std::vector<bool>& fused_scan,
+                      const std::unordered_map<std::string, std::string>& data_map) {
+  CostModel cost_model(data_map);
+  std::vector<double> costs;
+  costs.reserve(partitions.size());
+  for (size_t p = 0; p < partitions.size(); ++p) {
+    costs.push_back(cost_model.partition_cost(partitions[p], fused_scan[p]));
+  }
+
+  std::vector<std::vector<std::string>> ordered_partitions;
+  std::vector<bool> ordered_fused_scan;
+  for (size_t p : lpt_order(costs)) {
+    ordered_partitions.push_back(std::move(partitions[p]));
+    ordered_fused_scan.push_back(fused_scan[p]);
+  }
+  partitions = std::move(ordered_partitions);
+  fused_scan = std::move(ordered_fused_scan);
+}
+
+//////////////////////////////////////////////////////////////
+// Function to pass the estimated size of every output file to its writer, which preallocates
+// the space before the first write.
+void expect_output_sizes(const std::vector<std::vector<std::string>>& partitions, const std::vector<std::string>& partition_outputs,
+                         const std::unordered_map<std::string, std::string>& data_map) {
+  CostModel cost_model(data_map);
+  std::unordered_map<std::string, double> output_bytes;
+  for (size_t p = 0; p < partitions.size(); ++p) {
+    output_bytes[partition_outputs[p]] += cost_model.output_bytes(partitions[p]);
+  }
+  for (const auto& [path, bytes] : output_bytes) {
+    expect_output_bytes(path, static_cast<size_t>(bytes));
+  }
+}
+
 //////////////////////////////////////////////////////////////
 
 extern "C" {
 const char *execute_physical_plans(const char* information, const char* mode,
                            const char* continue_error,
-                           const char* output_file_path, const char* keep_data_in_memory, const char* json_data) {
+                           const char* output_file_path, const char* keep_data_in_memory, const char* json_data,
+                           const char* options) {
   // Get config variables //
   std::string continue_error_str(continue_error);
   bool continue_on_error = false;
@@ -125,23 +268,65 @@ const char *execute_physical_plans(const char* information, const char* mode,
   std::string ouput_file(output_file_path);
   
 
+  apply_options(std::string(options));
+  // Threads started from here on run on the CPUs of the budget
+  AffinityScope affinity_scope;
+
   std::string keep_in_memory_str(keep_data_in_memory);
   bool keep_in_memory = false;
   if (keep_in_memory_str == "true") {
     keep_in_memory = true;
   }
 
- // If keep in memory store in string
-  std::string output_data_str = "";
+ // If keep in memory the partition buffers are moved into the result store
+  result_store().reset(result_dictionary);
+
+  // Shards replace the output file, keep in memory has no files to shard
+  bool write_shards = sharded_output && !keep_in_memory;
+  bool stream_output = !keep_in_memory && is_stream_output(ouput_file);
+  if (write_shards && stream_output) {
+    std::cout << "Error: Sharded output needs an output file. Got: " << ouput_file << std::endl;
+    std::exit(1);
+  }
+
+  // Rotation writes out.0.nt, out.1.nt, ... instead of the output file
+  OutputSettings settings = output_configuration();
+  bool rotate_output = !keep_in_memory && (settings.rotate_bytes > 0 || settings.rotate_triples > 0);
+  if (rotate_output && (write_shards || stream_output)) {
+    std::cout << "Error: Output rotation needs a single output file. Got: " << ouput_file << std::endl;
+    std::exit(1);
+  }
+  // Concatenated shards are appended byte by byte, the binary format has one dictionary per file
+  // and sorted shards are not sorted or deduplicated across each other
+  if (write_shards && concatenate_output_shards && settings.format == OutputFormat::hdt) {
+    std::cout << "Error: Concatenated shards do not support the hdt output format." << std::endl;
+    std::exit(1);
+  }
+  if (write_shards && concatenate_output_shards && settings.sorted) {
+    std::cout << "Error: Concatenated shards do not support sorted output." << std::endl;
+    std::exit(1);
+  }
+  // Graph routing writes the quads into files next to the output file
+  bool route_graphs = !keep_in_memory && settings.route_graphs;
+  if (route_graphs && stream_output) {
+    std::cout << "Error: Graph routing needs an output file. Got: " << ouput_file << std::endl;
+    std::exit(1);
+  }
 
   // Clear output file
-  if (!keep_in_memory){
+  if (!keep_in_memory && !write_shards && !stream_output && !rotate_output){
     clear_output_file(ouput_file);
   }
+  if (rotate_output) {
+    output_writer(ouput_file);  // the first rotated file exists even without triples
+  }
 
   // Store number of generated triple
   std::atomic<int> nr_generate_triple(0);
 
+  // Sorted output removing duplicates makes the dedup of the partitions unnecessary
+  bool merge_dedup = !keep_in_memory && settings.sorted && settings.sort_dedup && settings.format != OutputFormat::hdt;
+
   ///////////////////
   // Process plans //
   std::vector<std::string> plan_partitions = split_by_substring(info, "TTTtttTTTtttTTT");
@@ -177,14 +362,34 @@ const char *execute_physical_plans(const char* information, const char* mode,
     }
   }
 
+  limit_self_joins(partitions, data_map);
+  std::vector<bool> fused_scan = fuse_shared_scans(partitions, keep_in_memory);
+  if (heuristic_ordering) {
+    order_partitions(partitions, fused_scan, data_map);
+  }
+
+  // Output file of every partition
+  std::vector<std::string> partition_outputs(partitions.size(), ouput_file);
+  if (write_shards) {
+    partition_outputs = assign_output_shards(partitions, ouput_file);
+  }
+  if (!keep_in_memory && settings.preallocate) {
+    expect_output_sizes(partitions, partition_outputs, data_map);
+  }
+
 
   //////////////////////////////////////////////////////////////////////////////////////////////////////77
   /// EXECUTE PLANS ///
   if (threading_enabled == "false") {
     /// SINGLE THREADED EXECUTION ///
-    for (const auto& partition : partitions) {
+    for (size_t p = 0; p < partitions.size(); ++p) {
+      const auto& partition = partitions[p];
+      // CASE 0: Simple plans sharing one scan of their source
+      if (fused_scan[p]) {
+        nr_generate_triple += fused_simple_mapping(partition, data_map);
+      }
       // CASE 1: Partition contains only one element and do not keep in memory
-      if (partition.size() == 1 && !keep_in_memory) {
+      else if (partition.size() == 1 && !keep_in_memory) {
         std::string plan_str = partition[0];
         int plan_size = split_by_substring(plan_str, "\n").size();
         if (plan_size == 5) {
@@ -195,54 +400,34 @@ const char *execute_physical_plans(const char* information, const char* mode,
       }
       // CASE 2: Partition contains multiple elements
       else {
-        std::unordered_set<std::string> unique_triple;
-        for (const auto& plan_str : partition) {
-          int plan_size = split_by_substring(plan_str, "\n").size();
-          if (plan_size == 5) {
-            unique_triple = dependent_simple_mapping(plan_str, unique_triple, data_map);
-          } else if (plan_size == 7) {
-            unique_triple = dependent_complex_mapping(plan_str, unique_triple, data_map);
-          }
-        }
-
-        nr_generate_triple += unique_triple.size();
-
-        // serialize //
         std::string buffer;
-        buffer.reserve(1024 * 1024);
-
-        for (const auto& triple : unique_triple) {
-          buffer += triple;  // data to buffer
-        }
+        nr_generate_triple += execute_dependent_partition(partition, buffer, nullptr, data_map, !merge_dedup);
 
         if (keep_in_memory){
-          output_data_str += buffer;
+          result_store().add(std::move(buffer));
         } else {
-          std::ofstream outputFile(ouput_file, std::ios::app);
-          if (!outputFile) {
-            std::cout << "Error: Unable to open file for writing." << std::endl;
-            std::exit(1);
-          }
-          outputFile << buffer;
-          outputFile.close();
+          output_writer(partition_outputs[p]).write(buffer);
         }
       }
     }
   } else {
     // THREADED EXECUTION
-    // Determine number of threads to use.
-    size_t numThreads = std::thread::hardware_concurrency();
-    if (numThreads == 0) {
-      numThreads = 2;
-    }
-    ThreadPool pool(numThreads);
-    std::mutex output_mutex;
-
-    // Enqueue each partition as a task.
-    for (const auto& partition : partitions) {
-      pool.enqueue([partition, &nr_generate_triple, &output_mutex, &ouput_file, keep_in_memory, &output_data_str, &data_map]() {
+    // Lease the whole CPU budget, nested stages run as tasks of the scheduler.
+    ThreadLease workers(ResourceManager::instance().budget());
+    Scheduler scheduler(workers.count());
+
+    // Spawn each partition as a task. Idle workers steal partitions and subtasks of running plans.
+    for (size_t p = 0; p < partitions.size(); ++p) {
+      const auto& partition = partitions[p];
+      const auto& partition_output = partition_outputs[p];
+      bool is_fused_scan = fused_scan[p];
+      scheduler.spawn([&partition, is_fused_scan, &nr_generate_triple, &partition_output, keep_in_memory, merge_dedup, &data_map]() {
+        // CASE 0: Simple plans sharing one scan of their source
+        if (is_fused_scan) {
+          nr_generate_triple.fetch_add(fused_simple_mapping(partition, data_map), std::memory_order_relaxed);
+        }
         // CASE 1: Partition contains only one element.
-        if (partition.size() == 1 && !keep_in_memory) {
+        else if (partition.size() == 1 && !keep_in_memory) {
           std::string plan_str = partition[0];
           int plan_size = split_by_substring(plan_str, "\n").size();
           if (plan_size == 5) {
@@ -253,46 +438,54 @@ const char *execute_physical_plans(const char* information, const char* mode,
         }
         // CASE 2: Partition contains multiple elements.
         else {
-          std::unordered_set<std::string> unique_triple;
-          for (const auto& plan_str : partition) {
-            int plan_size = split_by_substring(plan_str, "\n").size();
-            if (plan_size == 5) {
-              unique_triple = dependent_simple_mapping(plan_str, unique_triple, data_map);
-            } else if (plan_size == 7) {
-              unique_triple = dependent_complex_mapping(plan_str, unique_triple, data_map);
-            }
-          }
-          nr_generate_triple.fetch_add(unique_triple.size(), std::memory_order_relaxed);
-
-          // Serialize the unique triples.
           std::string buffer;
-          buffer.reserve(1024 * 1024);
-          for (const auto& triple : unique_triple) {
-            buffer += triple;
-          }
-      
-          // Protect file writing using a mutex.
-          std::lock_guard<std::mutex> lock(output_mutex);
+          nr_generate_triple.fetch_add(execute_dependent_partition(partition, buffer, Scheduler::current(), data_map, !merge_dedup), std::memory_order_relaxed);
+
+          // The output writer takes the buffer without waiting for the file
           if (keep_in_memory){
-            output_data_str += buffer;
+            result_store().add(std::move(buffer));
           } else {
-            std::ofstream outputFile(ouput_file, std::ios::app);
-            if (!outputFile) {
-              std::cout << "Error: Unable to open file for writing." << std::endl;
-              std::exit(1);
-            }
-            outputFile << buffer;
-            outputFile.close();
+            output_writer(partition_output).write(buffer);
           }
-          
         }
       });
     }
 
-    // Shutdown the pool to ensure all tasks finish.
-    pool.shutdown();
-  } 
-  final_result = std::to_string(nr_generate_triple.load()) + "|||" + output_data_str;
+    // Wait for all tasks and subtasks to finish.
+    scheduler.wait_idle();
+    scheduler.shutdown();
+  }
+  std::vector<OutputFileStats> written = close_output_writers();
+  if (merge_dedup) {
+    // The triples left after the duplicates were removed
+    size_t unique_triples = 0;
+    for (const auto& file : written) {
+      unique_triples += file.lines;
+    }
+    nr_generate_triple = static_cast<int>(unique_triples);
+  }
+  if (rotate_output) {
+    // The rotated files are listed like shards, with the triples of every file
+    std::vector<std::string> rotated_files;
+    for (const auto& file : written) {
+      if (file.graph.empty()) {
+        rotated_files.push_back(file.path);
+      }
+    }
+    write_shard_manifest(ouput_file, rotated_files, written);
+  }
+  if (route_graphs) {
+    write_graph_manifest(ouput_file, written);
+  }
+  if (write_shards) {
+    if (concatenate_output_shards) {
+      concatenate_shards(ouput_file, partition_outputs);
+    } else {
+      write_shard_manifest(ouput_file, partition_outputs, written);
+    }
+  }
+  // The triples kept in memory are read from the result store
+  final_result = std::to_string(nr_generate_triple.load()) + "|||";
   return final_result.c_str();
 }
 }
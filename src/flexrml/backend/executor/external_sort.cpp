@@ -0,0 +1,209 @@
+#include "external_sort.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <queue>
+
+// Smallest slice of a run sorted on its own
+constexpr size_t min_lines_per_thread = 64 * 1024;
+// Buffer of a run file while it is written or merged
+constexpr size_t run_file_buffer_size = 1024 * 1024;
+
+ExternalSorter::ExternalSorter(std::string run_prefix, size_t memory_limit, size_t threads, bool dedup, ParallelRunner run_parallel)
+    : run_prefix_(std::move(run_prefix)),
+      memory_limit_(memory_limit),
+      threads_(std::max<size_t>(threads, 1)),
+      dedup_(dedup),
+      run_parallel_(std::move(run_parallel)) {}
+
+ExternalSorter::~ExternalSorter() {
+  for (const auto& run_file : run_files_) {
+    std::error_code error;
+    std::filesystem::remove(run_file, error);
+  }
+}
+
+void ExternalSorter::add(std::string&& buffer) {
+  if (buffer.empty()) {
+    return;
+  }
+  buffers_.push_back(std::move(buffer));
+  std::string_view data(buffers_.back());
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    line_end = line_end == std::string_view::npos ? data.size() : line_end + 1;
+    lines_.push_back(data.substr(line_start, line_end - line_start));
+    line_start = line_end;
+  }
+
+  run_bytes_ += buffers_.back().capacity();
+  if (run_bytes_ + lines_.capacity() * sizeof(std::string_view) >= memory_limit_) {
+    spill_run();
+  }
+}
+
+// Slices of the run are sorted in parallel, then neighbouring slices are merged in rounds,
+// the merges of a round run in parallel
+void ExternalSorter::sort_run() {
+  size_t slices = std::min(threads_, lines_.size() / min_lines_per_thread + 1);
+  std::vector<size_t> bounds;
+  for (size_t i = 0; i <= slices; ++i) {
+    bounds.push_back(lines_.size() * i / slices);
+  }
+
+  run_parallel_(slices, [&](size_t i) { std::sort(lines_.begin() + bounds[i], lines_.begin() + bounds[i + 1]); });
+  for (size_t width = 1; width < slices; width *= 2) {
+    size_t merges = (slices + 2 * width - 1) / (2 * width);
+    run_parallel_(merges, [&](size_t i) {
+      size_t first = 2 * width * i;
+      size_t middle = std::min(first + width, slices);
+      size_t last = std::min(first + 2 * width, slices);
+      std::inplace_merge(lines_.begin() + bounds[first], lines_.begin() + bounds[middle], lines_.begin() + bounds[last]);
+    });
+  }
+}
+
+// Sort the run and write it to the next run file, the memory of the run is released
+void ExternalSorter::spill_run() {
+  if (lines_.empty()) {
+    return;
+  }
+  sort_run();
+
+  std::string run_file = run_prefix_ + ".run-" + std::to_string(run_files_.size());
+  FILE* file = std::fopen(run_file.c_str(), "wb");
+  if (file == nullptr) {
+    std::cerr << "Error: Unable to create sort run file " << run_file << ": " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+  run_files_.push_back(run_file);
+  std::setvbuf(file, nullptr, _IOFBF, run_file_buffer_size);
+
+  std::string_view previous;
+  for (const auto& line : lines_) {
+    if (dedup_ && line == previous) {
+      continue;
+    }
+    if (std::fwrite(line.data(), 1, line.size(), file) != line.size()) {
+      std::cerr << "Error: Writing sort run file " << run_file << " failed: " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+    previous = line;
+  }
+  if (std::fclose(file) != 0) {
+    std::cerr << "Error: Writing sort run file " << run_file << " failed: " << std::strerror(errno) << std::endl;
+    std::exit(1);
+  }
+
+  std::vector<std::string_view>().swap(lines_);
+  buffers_.clear();
+  run_bytes_ = 0;
+}
+
+void ExternalSorter::finish(const std::function<void(std::string&)>& emit) {
+  if (run_files_.empty()) {
+    sort_run();
+    emit_run(emit);
+  } else {
+    spill_run();
+    merge_runs(emit);
+  }
+  std::vector<std::string_view>().swap(lines_);
+  buffers_.clear();
+}
+
+// A run that fits into memory is never spilled, it is emitted directly
+void ExternalSorter::emit_run(const std::function<void(std::string&)>& emit) {
+  std::string output;
+  std::string_view previous;
+  for (const auto& line : lines_) {
+    if (dedup_ && line == previous) {
+      continue;
+    }
+    output += line;
+    previous = line;
+    if (output.size() >= output_buffer_size) {
+      emit(output);
+      output.clear();
+    }
+  }
+  if (!output.empty()) {
+    emit(output);
+  }
+}
+
+namespace {
+
+// Sequential reader of a run file, line is the current line including its line end
+struct RunReader {
+  FILE* file = nullptr;
+  char* data = nullptr;
+  size_t capacity = 0;
+  std::string_view line;
+
+  bool next() {
+    ssize_t length = ::getline(&data, &capacity, file);
+    if (length < 0) {
+      return false;
+    }
+    line = std::string_view(data, length);
+    return true;
+  }
+
+  ~RunReader() {
+    std::free(data);
+    if (file != nullptr) {
+      std::fclose(file);
+    }
+  }
+};
+
+}  // namespace
+
+// k-way merge of the sorted run files, the smallest current line of all runs is taken next
+void ExternalSorter::merge_runs(const std::function<void(std::string&)>& emit) {
+  std::vector<RunReader> readers(run_files_.size());
+  auto greater = [&readers](size_t a, size_t b) { return readers[a].line > readers[b].line; };
+  std::priority_queue<size_t, std::vector<size_t>, decltype(greater)> heap(greater);
+  for (size_t i = 0; i < run_files_.size(); ++i) {
+    readers[i].file = std::fopen(run_files_[i].c_str(), "rb");
+    if (readers[i].file == nullptr) {
+      std::cerr << "Error: Unable to open sort run file " << run_files_[i] << std::endl;
+      std::exit(1);
+    }
+    std::setvbuf(readers[i].file, nullptr, _IOFBF, run_file_buffer_size);
+    if (readers[i].next()) {
+      heap.push(i);
+    }
+  }
+
+  std::string output;
+  std::string previous;
+  while (!heap.empty()) {
+    size_t run = heap.top();
+    heap.pop();
+    std::string_view line = readers[run].line;
+    if (!dedup_ || line != previous) {
+      output += line;
+      if (dedup_) {
+        previous.assign(line);
+      }
+      if (output.size() >= output_buffer_size) {
+        emit(output);
+        output.clear();
+      }
+    }
+    if (readers[run].next()) {
+      heap.push(run);
+    }
+  }
+  if (!output.empty()) {
+    emit(output);
+  }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sorts the lines of an output with bounded memory. Lines are collected into a run, a full
+// run is sorted in slices by the parallel runner of the owner and spilled to a run file. finish merges the runs and hands
+// the sorted lines on in buffers, duplicate lines are removed on request.
+class ExternalSorter {
+ public:
+  static constexpr size_t output_buffer_size = 1024 * 1024;
+
+  // Runs task(0) ... task(tasks - 1), possibly in parallel, and returns when all have finished
+  using ParallelRunner = std::function<void(size_t tasks, const std::function<void(size_t)>& task)>;
+
+  // Run files are named run_prefix.run-N, they are removed when the sorter is destroyed.
+  // A run is sorted in at most threads slices.
+  ExternalSorter(std::string run_prefix, size_t memory_limit, size_t threads, bool dedup, ParallelRunner run_parallel);
+  ~ExternalSorter();
+
+  ExternalSorter(const ExternalSorter&) = delete;
+  ExternalSorter& operator=(const ExternalSorter&) = delete;
+
+  // Adds the complete lines of a buffer.
+  void add(std::string&& buffer);
+
+  // Passes the sorted lines to emit in buffers of about output_buffer_size bytes.
+  void finish(const std::function<void(std::string&)>& emit);
+
+  size_t spilled_runs() const { return run_files_.size(); }
+
+ private:
+  void sort_run();
+  void spill_run();
+  void emit_run(const std::function<void(std::string&)>& emit);
+  void merge_runs(const std::function<void(std::string&)>& emit);
+
+  std::string run_prefix_;
+  size_t memory_limit_;
+  size_t threads_;
+  bool dedup_;
+  ParallelRunner run_parallel_;
+
+  // Lines of the current run, viewing into the buffers. A deque never moves its buffers.
+  std::deque<std::string> buffers_;
+  std::vector<std::string_view> lines_;
+  size_t run_bytes_ = 0;
+  std::vector<std::string> run_files_;
+};
@@ -0,0 +1,202 @@
+#include "hdt_output.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "ntriples.h"
+
+// Terms per front coded block of a dictionary section
+constexpr size_t dictionary_block_size = 16;
+
+// Term as stored in the dictionary, IRIs without angle brackets
+static std::string_view dictionary_term(std::string_view term) {
+  if (term.size() >= 2 && term.front() == '<') {
+    return term.substr(1, term.size() - 2);
+  }
+  return term;
+}
+
+uint32_t HdtEncoder::encode(std::string_view term, uint8_t role) {
+  auto it = ids_.find(term);
+  if (it == ids_.end()) {
+    it = ids_.emplace(std::string(term), static_cast<uint32_t>(terms_.size())).first;
+    terms_.push_back(&it->first);
+    roles_.push_back(0);
+  }
+  roles_[it->second] |= role;
+  return it->second;
+}
+
+void HdtEncoder::add(const std::string& buffer) {
+  std::string_view data(buffer);
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    if (line_end == std::string_view::npos) {
+      line_end = data.size();
+    }
+    std::string_view line = data.substr(line_start, line_end - line_start);
+    line_start = line_end + 1;
+    if (line.empty()) {
+      continue;
+    }
+
+    std::array<std::string_view, 4> terms;
+    if (split_ntriples_line(line, terms) == 0) {
+      std::cerr << "Error: Unable to encode generated triple. Got: " << line << std::endl;
+      std::exit(1);
+    }
+    triples_.push_back(encode(dictionary_term(terms[0]), subject_role));
+    triples_.push_back(encode(dictionary_term(terms[1]), predicate_role));
+    triples_.push_back(encode(dictionary_term(terms[2]), object_role));
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+/// Serialization
+
+// Variable byte integer as in HDT, 7 bits per byte, the last byte has the high bit set
+static void write_vbyte(std::string& out, uint64_t value) {
+  while (value > 127) {
+    out.push_back(static_cast<char>(value & 127));
+    value >>= 7;
+  }
+  out.push_back(static_cast<char>(value | 128));
+}
+
+// Section of sorted terms, plain front coding: the first term of a block is stored in full,
+// the others as length of the prefix shared with the previous term and the rest.
+static void write_section(std::string& out, const std::vector<const std::string*>& terms) {
+  std::string data;
+  std::vector<size_t> block_offsets;
+  for (size_t i = 0; i < terms.size(); ++i) {
+    const std::string& term = *terms[i];
+    if (i % dictionary_block_size == 0) {
+      block_offsets.push_back(data.size());
+      data += term;
+    } else {
+      const std::string& previous = *terms[i - 1];
+      size_t shared = std::mismatch(term.begin(), term.begin() + std::min(term.size(), previous.size()), previous.begin()).first -
+                      term.begin();
+      write_vbyte(data, shared);
+      data.append(term, shared);
+    }
+    data.push_back('\0');
+  }
+
+  write_vbyte(out, terms.size());
+  write_vbyte(out, dictionary_block_size);
+  write_vbyte(out, block_offsets.size());
+  for (size_t offset : block_offsets) {
+    write_vbyte(out, offset);
+  }
+  write_vbyte(out, data.size());
+  out += data;
+}
+
+static void write_sequence(std::string& out, const std::vector<uint32_t>& values) {
+  write_vbyte(out, values.size());
+  for (uint32_t value : values) {
+    write_vbyte(out, value);
+  }
+}
+
+static void write_bitmap(std::string& out, const std::vector<bool>& bits) {
+  write_vbyte(out, bits.size());
+  for (size_t word_start = 0; word_start < bits.size(); word_start += 64) {
+    uint64_t word = 0;
+    for (size_t bit = 0; bit < 64 && word_start + bit < bits.size(); ++bit) {
+      word |= static_cast<uint64_t>(bits[word_start + bit]) << bit;
+    }
+    for (int byte = 0; byte < 8; ++byte) {
+      out.push_back(static_cast<char>(word >> (8 * byte)));
+    }
+  }
+}
+
+std::string HdtEncoder::serialize() {
+  // Dictionary sections, terms in subject and object position form the shared section
+  std::vector<uint32_t> shared, subjects, predicates, objects;
+  for (uint32_t id = 0; id < terms_.size(); ++id) {
+    uint8_t role = roles_[id];
+    if ((role & subject_role) && (role & object_role)) {
+      shared.push_back(id);
+    } else if (role & subject_role) {
+      subjects.push_back(id);
+    } else if (role & object_role) {
+      objects.push_back(id);
+    }
+    if (role & predicate_role) {
+      predicates.push_back(id);
+    }
+  }
+
+  // Sort each section and number its terms. Subject and object IDs start after the
+  // shared section, predicates have their own IDs. IDs start at 1.
+  std::vector<uint32_t> so_id(terms_.size(), 0);
+  std::vector<uint32_t> predicate_id(terms_.size(), 0);
+  auto by_term = [this](uint32_t a, uint32_t b) { return *terms_[a] < *terms_[b]; };
+  auto number = [&](std::vector<uint32_t>& section, std::vector<uint32_t>& section_id, uint32_t first) {
+    std::sort(section.begin(), section.end(), by_term);
+    for (size_t i = 0; i < section.size(); ++i) {
+      section_id[section[i]] = first + static_cast<uint32_t>(i);
+    }
+  };
+  number(shared, so_id, 1);
+  number(subjects, so_id, static_cast<uint32_t>(shared.size()) + 1);
+  number(objects, so_id, static_cast<uint32_t>(shared.size()) + 1);
+  number(predicates, predicate_id, 1);
+
+  std::vector<std::array<uint32_t, 3>> triples;
+  triples.reserve(triples_.size() / 3);
+  for (size_t i = 0; i < triples_.size(); i += 3) {
+    triples.push_back({so_id[triples_[i]], predicate_id[triples_[i + 1]], so_id[triples_[i + 2]]});
+  }
+  std::vector<uint32_t>().swap(triples_);
+  std::sort(triples.begin(), triples.end());
+  triples.erase(std::unique(triples.begin(), triples.end()), triples.end());
+
+  // Bitmap triples: subjects are implicit, Bp marks the last predicate of a subject,
+  // Bo the last object of a subject and predicate pair
+  std::vector<uint32_t> predicate_ids, object_ids;
+  std::vector<bool> predicate_bits, object_bits;
+  object_ids.reserve(triples.size());
+  object_bits.reserve(triples.size());
+  for (size_t i = 0; i < triples.size(); ++i) {
+    bool last = i + 1 == triples.size();
+    bool last_of_subject = last || triples[i + 1][0] != triples[i][0];
+    bool last_of_pair = last_of_subject || triples[i + 1][1] != triples[i][1];
+    object_ids.push_back(triples[i][2]);
+    object_bits.push_back(last_of_pair);
+    if (last_of_pair) {
+      predicate_ids.push_back(triples[i][1]);
+      predicate_bits.push_back(last_of_subject);
+    }
+  }
+
+  auto term_strings = [this](const std::vector<uint32_t>& section) {
+    std::vector<const std::string*> strings;
+    strings.reserve(section.size());
+    for (uint32_t id : section) {
+      strings.push_back(terms_[id]);
+    }
+    return strings;
+  };
+
+  std::string out = "FLEXHDT1";
+  write_vbyte(out, triples.size());
+  write_vbyte(out, shared.size());
+  write_vbyte(out, subjects.size());
+  write_vbyte(out, predicates.size());
+  write_vbyte(out, objects.size());
+  write_section(out, term_strings(shared));
+  write_section(out, term_strings(subjects));
+  write_section(out, term_strings(predicates));
+  write_section(out, term_strings(objects));
+  write_sequence(out, predicate_ids);
+  write_bitmap(out, predicate_bits);
+  write_sequence(out, object_ids);
+  write_bitmap(out, object_bits);
+  return out;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Dictionary encoder of the binary RDF output. Generated N-Triples are encoded into term IDs
+// as they arrive, the file is written once all triples are known. The layout follows HDT:
+// a dictionary with shared, subject, predicate and object sections, each sorted and front
+// coded in blocks, and bitmap triples sorted by subject, predicate and object.
+// Graph terms of quads are dropped, HDT holds a single graph.
+class HdtEncoder {
+ public:
+  // Encode the triples of a buffer of complete N-Triples / N-Quads lines.
+  void add(const std::string& buffer);
+
+  // The encoded file, duplicate triples are removed.
+  std::string serialize();
+
+ private:
+  static constexpr uint8_t subject_role = 1;
+  static constexpr uint8_t predicate_role = 2;
+  static constexpr uint8_t object_role = 4;
+
+  // Finds terms by string_view without copying them
+  struct TermHash {
+    using is_transparent = void;
+    size_t operator()(std::string_view term) const { return std::hash<std::string_view>{}(term); }
+  };
+
+  uint32_t encode(std::string_view term, uint8_t role);
+
+  // Term -> ID in order of first appearance, the keys own the term strings
+  std::unordered_map<std::string, uint32_t, TermHash, std::equal_to<>> ids_;
+  std::vector<const std::string*> terms_;
+  std::vector<uint8_t> roles_;
+  std::vector<uint32_t> triples_;  // subject, predicate, object IDs
+};
@@ -0,0 +1,329 @@
+#include "join_index.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <thread>
+
+#include "definitions.h"
+#include "xxhash.h"
+
+namespace fs = std::filesystem;
+
+// Layout of a join index file, the sections of the table follow each other 8 byte aligned:
+//   magic (8 bytes) | key length (u64) | key | padding | row count | column count | bucket bits |
+//   arena size | buckets | hashes | rows | offsets (all u64) | arena
+static constexpr char join_index_magic[8] = {'F', 'X', 'J', 'I', 'D', 'X', '0', '2'};
+
+void JoinHashTable::insert(uint64_t key_hash, const std::vector<std::string>& row) {
+  column_count_ = row.size();
+  owned_hashes_.push_back(key_hash);
+  for (const auto& value : row) {
+    owned_arena_.insert(owned_arena_.end(), value.begin(), value.end());
+    owned_offsets_.push_back(owned_arena_.size());
+  }
+  ++row_count_;
+}
+
+// Entries are sorted by key hash, the rows of a key keep their insertion order. A bucket per row
+// keeps the search for a hash in a few entries.
+void JoinHashTable::finish() {
+  std::vector<std::pair<uint64_t, uint64_t>> entries(row_count_);
+  for (uint64_t row = 0; row < row_count_; ++row) {
+    entries[row] = {owned_hashes_[row], row};
+  }
+  std::sort(entries.begin(), entries.end());
+
+  owned_rows_.resize(row_count_);
+  for (uint64_t entry = 0; entry < row_count_; ++entry) {
+    owned_hashes_[entry] = entries[entry].first;
+    owned_rows_[entry] = entries[entry].second;
+  }
+
+  bucket_bits_ = 0;
+  while ((uint64_t{1} << bucket_bits_) < row_count_) {
+    ++bucket_bits_;
+  }
+  owned_buckets_.assign((uint64_t{1} << bucket_bits_) + 1, 0);
+  for (uint64_t entry = 0; entry < row_count_; ++entry) {
+    ++owned_buckets_[bucket(owned_hashes_[entry]) + 1];
+  }
+  for (size_t b = 1; b < owned_buckets_.size(); ++b) {
+    owned_buckets_[b] += owned_buckets_[b - 1];
+  }
+
+  arena_size_ = owned_arena_.size();
+  buckets_ = owned_buckets_.data();
+  hashes_ = owned_hashes_.data();
+  rows_ = owned_rows_.data();
+  offsets_ = owned_offsets_.data();
+  arena_ = owned_arena_.data();
+}
+
+JoinHashTable::Range JoinHashTable::equal_range(uint64_t key_hash) const {
+  if (row_count_ == 0) {
+    return Range(this, 0, 0);
+  }
+  size_t b = bucket(key_hash);
+  auto [first, last] = std::equal_range(hashes_ + buckets_[b], hashes_ + buckets_[b + 1], key_hash);
+  return Range(this, first - hashes_, last - hashes_);
+}
+
+std::string join_index_key(const std::string& source_path,
+                           const std::vector<std::string>& projected_attributes,
+                           const std::vector<std::string>& join_attrs) {
+  if (join_index_dir.empty()) {
+    return "";
+  }
+
+  struct stat source_stat;
+  if (stat(source_path.c_str(), &source_stat) != 0 || !S_ISREG(source_stat.st_mode)) {
+    return "";
+  }
+
+  std::error_code ec;
+  fs::path absolute_path = fs::absolute(source_path, ec);
+  if (ec) {
+    return "";
+  }
+
+  std::string key = absolute_path.string();
+  key += "|";
+  for (const auto& attr : projected_attributes) {
+    key += attr + "===";
+  }
+  key += "|";
+  for (const auto& attr : join_attrs) {
+    key += attr + "===";
+  }
+  // The version of the source ends the key after a line break
+  key += "\n" + std::to_string(source_stat.st_size);
+  key += "|" + std::to_string(source_stat.st_mtim.tv_sec) + "." + std::to_string(source_stat.st_mtim.tv_nsec);
+  return key;
+}
+
+// The file name is the hash of the key without the version of the source, an index rebuilt after
+// the source changed replaces the stale one. The whole key is stored in the file to detect
+// collisions and stale indexes.
+static std::string join_index_path(const std::string& key) {
+  size_t version = std::min(key.rfind('\n'), key.size());
+  char file_name[32];
+  std::snprintf(file_name, sizeof(file_name), "%016llx.fxji", static_cast<unsigned long long>(XXH3_64bits(key.data(), version)));
+  return (fs::path(join_index_dir) / file_name).string();
+}
+
+// Reads the sections of a mapped index, fails on any access past the end of the file.
+class IndexReader {
+ public:
+  IndexReader(const char* data, size_t size) : data_(data), size_(size) {}
+
+  template <typename T>
+  bool read(T& value) {
+    if (size_ - position_ < sizeof(T)) {
+      return false;
+    }
+    std::memcpy(&value, data_ + position_, sizeof(T));
+    position_ += sizeof(T);
+    return true;
+  }
+
+  bool read(std::string_view& value, size_t length) {
+    if (size_ - position_ < length) {
+      return false;
+    }
+    value = std::string_view(data_ + position_, length);
+    position_ += length;
+    return true;
+  }
+
+  // count u64 values, the position is 8 byte aligned
+  bool read(const uint64_t*& values, uint64_t count) {
+    if ((size_ - position_) / sizeof(uint64_t) < count) {
+      return false;
+    }
+    values = reinterpret_cast<const uint64_t*>(data_ + position_);
+    position_ += count * sizeof(uint64_t);
+    return true;
+  }
+
+  bool align() {
+    size_t padding = (sizeof(uint64_t) - position_ % sizeof(uint64_t)) % sizeof(uint64_t);
+    if (size_ - position_ < padding) {
+      return false;
+    }
+    position_ += padding;
+    return true;
+  }
+
+  bool at_end() const { return position_ == size_; }
+
+ private:
+  const char* data_;
+  size_t size_;
+  size_t position_ = 0;
+};
+
+// Sections of a mapped index
+struct IndexSections {
+  uint64_t row_count = 0;
+  uint64_t column_count = 0;
+  uint64_t bucket_bits = 0;
+  uint64_t arena_size = 0;
+  const uint64_t* buckets = nullptr;
+  const uint64_t* hashes = nullptr;
+  const uint64_t* rows = nullptr;
+  const uint64_t* offsets = nullptr;
+  std::string_view arena;
+};
+
+// Checks the entries of the sections in one pass, so a damaged index is never probed out of
+// bounds: the buckets and offsets ascend to the entry count and arena size, the hashes are
+// sorted in their buckets and the rows exist.
+static bool valid_join_index(const IndexSections& sections) {
+  const auto& [row_count, column_count, bucket_bits, arena_size, buckets, hashes, rows, offsets, arena] = sections;
+  uint64_t bucket_count = uint64_t{1} << bucket_bits;
+  if (buckets[0] != 0 || buckets[bucket_count] != row_count || offsets[0] != 0 || offsets[row_count * column_count] != arena_size) {
+    return false;
+  }
+  for (uint64_t b = 0; b < bucket_count; ++b) {
+    if (buckets[b] > buckets[b + 1]) {
+      return false;
+    }
+    for (uint64_t entry = buckets[b]; entry < buckets[b + 1]; ++entry) {
+      uint64_t bucket = bucket_bits == 0 ? 0 : hashes[entry] >> (64 - bucket_bits);
+      if (bucket != b || (entry > buckets[b] && hashes[entry - 1] > hashes[entry]) || rows[entry] >= row_count) {
+        return false;
+      }
+    }
+  }
+  for (uint64_t value = 0; value < row_count * column_count; ++value) {
+    if (offsets[value] > offsets[value + 1]) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// The index is written to a temporary file and renamed, loading checks the header, the sizes
+// of the sections and every entry.
+static bool read_join_index(IndexReader& reader, const std::string& expected_key, IndexSections& sections) {
+  std::string_view magic;
+  if (!reader.read(magic, sizeof(join_index_magic)) || magic != std::string_view(join_index_magic, sizeof(join_index_magic))) {
+    return false;
+  }
+
+  uint64_t key_length;
+  std::string_view key;
+  if (!reader.read(key_length) || !reader.read(key, key_length) || key != expected_key || !reader.align()) {
+    return false;
+  }
+
+  auto& [row_count, column_count, bucket_bits, arena_size, buckets, hashes, rows, offsets, arena] = sections;
+  if (!reader.read(row_count) || !reader.read(column_count) || !reader.read(bucket_bits) || !reader.read(arena_size) ||
+      bucket_bits >= 48 || (row_count > 0 && column_count > std::numeric_limits<uint64_t>::max() / row_count)) {
+    return false;
+  }
+
+  if (!reader.read(buckets, (uint64_t{1} << bucket_bits) + 1) || !reader.read(hashes, row_count) || !reader.read(rows, row_count) ||
+      !reader.read(offsets, row_count * column_count + 1) || !reader.read(arena, arena_size) || !reader.at_end()) {
+    return false;
+  }
+  return valid_join_index(sections);
+}
+
+bool load_join_index(const std::string& key, JoinHashTable& hash_table) {
+  int fd = open(join_index_path(key).c_str(), O_RDONLY);
+  if (fd < 0) {
+    return false;
+  }
+
+  struct stat index_stat;
+  if (fstat(fd, &index_stat) != 0 || index_stat.st_size == 0) {
+    close(fd);
+    return false;
+  }
+
+  size_t size = static_cast<size_t>(index_stat.st_size);
+  void* data = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return false;
+  }
+
+  std::shared_ptr<const void> mapping(data, [size](const void* mapping) { munmap(const_cast<void*>(mapping), size); });
+  IndexReader reader(static_cast<const char*>(data), size);
+  IndexSections sections;
+  if (!read_join_index(reader, key, sections)) {
+    return false;
+  }
+
+  // The table probes the mapped sections, the mapping lives as long as the table
+  hash_table = JoinHashTable();
+  hash_table.row_count_ = sections.row_count;
+  hash_table.column_count_ = sections.column_count;
+  hash_table.bucket_bits_ = sections.bucket_bits;
+  hash_table.arena_size_ = sections.arena_size;
+  hash_table.buckets_ = sections.buckets;
+  hash_table.hashes_ = sections.hashes;
+  hash_table.rows_ = sections.rows;
+  hash_table.offsets_ = sections.offsets;
+  hash_table.arena_ = sections.arena.data();
+  hash_table.mapping_ = std::move(mapping);
+  return true;
+}
+
+template <typename T>
+static void write_value(std::ofstream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void save_join_index(const std::string& key, const JoinHashTable& hash_table) {
+  std::error_code ec;
+  fs::create_directories(join_index_dir, ec);
+  std::string index_path = join_index_path(key);
+
+  // Write to a temporary file and rename it, so concurrent runs never read a partial index
+  std::string tmp_path = index_path + ".tmp" + std::to_string(getpid()) + "_" +
+                         std::to_string(std::hash<std::thread::id>{}(std::this_thread::get_id()));
+  std::ofstream out(tmp_path, std::ios::binary | std::ios::trunc);
+  if (!out) {
+    std::cerr << "Warning: Unable to write join index " << index_path << std::endl;
+    return;
+  }
+
+  out.write(join_index_magic, sizeof(join_index_magic));
+  write_value(out, static_cast<uint64_t>(key.size()));
+  out.write(key.data(), key.size());
+  static constexpr char padding[sizeof(uint64_t)] = {};
+  out.write(padding, (sizeof(uint64_t) - (sizeof(join_index_magic) + sizeof(uint64_t) + key.size()) % sizeof(uint64_t)) % sizeof(uint64_t));
+
+  write_value(out, hash_table.row_count_);
+  write_value(out, hash_table.column_count_);
+  write_value(out, hash_table.bucket_bits_);
+  write_value(out, hash_table.arena_size_);
+  auto write_section = [&out](const uint64_t* values, uint64_t count) {
+    out.write(reinterpret_cast<const char*>(values), count * sizeof(uint64_t));
+  };
+  write_section(hash_table.buckets_, (uint64_t{1} << hash_table.bucket_bits_) + 1);
+  write_section(hash_table.hashes_, hash_table.row_count_);
+  write_section(hash_table.rows_, hash_table.row_count_);
+  write_section(hash_table.offsets_, hash_table.row_count_ * hash_table.column_count_ + 1);
+  out.write(hash_table.arena_, hash_table.arena_size_);
+  out.close();
+
+  if (!out || std::rename(tmp_path.c_str(), index_path.c_str()) != 0) {
+    std::remove(tmp_path.c_str());
+    std::cerr << "Warning: Unable to write join index " << index_path << std::endl;
+  }
+}
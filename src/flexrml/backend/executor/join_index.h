@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Hash table of the build side of a join, keyed by the combined hash of the join columns.
+// The table is a flat layout that is probed in place, the same layout is the join index file:
+// the entries sorted by key hash with a directory of buckets over the top bits of the hash,
+// the row of every entry and the column offsets of the rows into one arena of values.
+// A loaded join index maps the file and probes it directly, the values are read as views.
+class JoinHashTable {
+ public:
+  // Projected columns of a build row, valid as long as the table
+  class Row {
+   public:
+    Row(const JoinHashTable* table, uint64_t row) : table_(table), row_(row) {}
+    std::string_view operator[](size_t column) const;
+    size_t size() const { return table_->column_count_; }
+
+   private:
+    const JoinHashTable* table_;
+    uint64_t row_;
+  };
+
+  // Entries [first, last), iterated as their rows
+  class Range {
+   public:
+    class Iterator {
+     public:
+      Iterator(const JoinHashTable* table, size_t entry) : table_(table), entry_(entry) {}
+      Row operator*() const { return table_->row(entry_); }
+      Iterator& operator++() {
+        ++entry_;
+        return *this;
+      }
+      bool operator!=(const Iterator& other) const { return entry_ != other.entry_; }
+
+     private:
+      const JoinHashTable* table_;
+      size_t entry_;
+    };
+
+    Range(const JoinHashTable* table, size_t first, size_t last) : table_(table), first_(first), last_(last) {}
+    Iterator begin() const { return Iterator(table_, first_); }
+    Iterator end() const { return Iterator(table_, last_); }
+    size_t first() const { return first_; }
+    size_t size() const { return last_ - first_; }
+
+   private:
+    const JoinHashTable* table_;
+    size_t first_;
+    size_t last_;
+  };
+
+  JoinHashTable() = default;
+  JoinHashTable(JoinHashTable&&) = default;
+  JoinHashTable& operator=(JoinHashTable&&) = default;
+  JoinHashTable(const JoinHashTable&) = delete;
+  JoinHashTable& operator=(const JoinHashTable&) = delete;
+
+  // Adds a build row, the table can be probed after finish.
+  void insert(uint64_t key_hash, const std::vector<std::string>& row);
+  void finish();
+
+  size_t size() const { return row_count_; }
+  uint64_t key_hash(size_t entry) const { return hashes_[entry]; }
+  Row row(size_t entry) const { return Row(this, rows_[entry]); }
+  Range equal_range(uint64_t key_hash) const;
+
+ private:
+  friend bool load_join_index(const std::string& key, JoinHashTable& hash_table);
+  friend void save_join_index(const std::string& key, const JoinHashTable& hash_table);
+
+  size_t bucket(uint64_t key_hash) const { return bucket_bits_ == 0 ? 0 : key_hash >> (64 - bucket_bits_); }
+
+  uint64_t row_count_ = 0;
+  uint64_t column_count_ = 0;
+  uint64_t bucket_bits_ = 0;
+  uint64_t arena_size_ = 0;
+  // Sections of the layout, in the owned vectors or in the mapped index
+  const uint64_t* buckets_ = nullptr;  // first entry of every bucket and the entry count
+  const uint64_t* hashes_ = nullptr;   // key hash of every entry, sorted
+  const uint64_t* rows_ = nullptr;     // row of every entry
+  const uint64_t* offsets_ = nullptr;  // start of every value in the arena and the arena size
+  const char* arena_ = nullptr;
+
+  std::vector<uint64_t> owned_buckets_;
+  std::vector<uint64_t> owned_hashes_;
+  std::vector<uint64_t> owned_rows_;
+  std::vector<uint64_t> owned_offsets_{0};
+  std::vector<char> owned_arena_;
+  std::shared_ptr<const void> mapping_;  // of a loaded join index
+};
+
+inline std::string_view JoinHashTable::Row::operator[](size_t column) const {
+  const uint64_t* offsets = table_->offsets_ + row_ * table_->column_count_ + column;
+  return std::string_view(table_->arena_ + offsets[0], offsets[1] - offsets[0]);
+}
+
+// Returns the key of the join index for a source, or "" if no join index directory is configured
+// or the source is not a file. The key changes whenever the source or the projection changes,
+// the index of a changed source replaces the stale one.
+std::string join_index_key(const std::string& source_path,
+                           const std::vector<std::string>& projected_attributes,
+                           const std::vector<std::string>& join_attrs);
+
+// Maps the join index stored for a key. Returns false if the index does not exist or is invalid.
+bool load_join_index(const std::string& key, JoinHashTable& hash_table);
+
+void save_join_index(const std::string& key, const JoinHashTable& hash_table);
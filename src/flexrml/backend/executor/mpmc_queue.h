@@ -0,0 +1,202 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <thread>
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Lock-free bounded multi-producer multi-consumer queue
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Ring buffer where every cell carries a sequence number telling producers and consumers
+// whose turn it is (Vyukov). Push and pop never take a lock. Blocking push/pop spin briefly
+// and then park on an atomic counter (futex), producers and consumers only signal if
+// somebody is actually parked.
+template <typename T>
+class BoundedMPMCQueue {
+ public:
+  explicit BoundedMPMCQueue(size_t capacity) {
+    capacity_ = 2;
+    while (capacity_ < capacity) {
+      capacity_ <<= 1;
+    }
+    mask_ = capacity_ - 1;
+    cells_ = std::make_unique<Cell[]>(capacity_);
+    for (size_t i = 0; i < capacity_; ++i) {
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    }
+  }
+
+  BoundedMPMCQueue(const BoundedMPMCQueue&) = delete;
+  BoundedMPMCQueue& operator=(const BoundedMPMCQueue&) = delete;
+
+  // Moves value into the queue if there is space.
+  bool try_push(T& value) {
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[pos & mask_];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos);
+      if (diff == 0) {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          cell.data = std::move(value);
+          cell.sequence.store(pos + 1, std::memory_order_release);
+          signal(not_empty_, waiting_consumers_);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // full
+      } else {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  bool try_pop(T& value) {
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;) {
+      Cell& cell = cells_[pos & mask_];
+      size_t sequence = cell.sequence.load(std::memory_order_acquire);
+      intptr_t diff = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(pos + 1);
+      if (diff == 0) {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+          value = std::move(cell.data);
+          cell.sequence.store(pos + mask_ + 1, std::memory_order_release);
+          signal(not_full_, waiting_producers_);
+          return true;
+        }
+      } else if (diff < 0) {
+        return false;  // empty
+      } else {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+  }
+
+  // Blocks while the queue is full. The value is dropped if the queue is finished.
+  void push(T value) {
+    for (int spin = 0;; ++spin) {
+      if (finished_.load(std::memory_order_acquire) || try_push(value)) {
+        return;
+      }
+      if (spin < spin_limit) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (park(not_full_, waiting_producers_, [&] { return try_push(value); })) {
+        return;
+      }
+      spin = 0;
+    }
+  }
+
+  // Blocks while the queue is empty. Returns false once the queue is finished and drained.
+  bool pop(T& value) {
+    for (int spin = 0;; ++spin) {
+      if (try_pop(value)) {
+        return true;
+      }
+      if (finished_.load(std::memory_order_acquire)) {
+        // Items pushed before finishing are still handed out
+        return try_pop(value);
+      }
+      if (spin < spin_limit) {
+        std::this_thread::yield();
+        continue;
+      }
+      if (park(not_empty_, waiting_consumers_, [&] { return try_pop(value); })) {
+        return true;
+      }
+      spin = 0;
+    }
+  }
+
+  void set_finished() {
+    finished_.store(true, std::memory_order_release);
+    not_empty_.fetch_add(1, std::memory_order_release);
+    not_empty_.notify_all();
+    not_full_.fetch_add(1, std::memory_order_release);
+    not_full_.notify_all();
+  }
+
+  size_t size() const {
+    size_t enqueued = enqueue_pos_.load(std::memory_order_relaxed);
+    size_t dequeued = dequeue_pos_.load(std::memory_order_relaxed);
+    return enqueued > dequeued ? enqueued - dequeued : 0;
+  }
+
+ private:
+  struct Cell {
+    std::atomic<size_t> sequence;
+    T data;
+  };
+
+  static constexpr int spin_limit = 64;
+
+  // Wake one parked thread, only touches the futex if a thread is parked.
+  void signal(std::atomic<uint32_t>& event, std::atomic<uint32_t>& waiting) {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiting.load(std::memory_order_relaxed) > 0) {
+      event.fetch_add(1, std::memory_order_release);
+      event.notify_one();
+    }
+  }
+
+  // Sleep until the event changes. retry is checked after announcing the wait,
+  // so a signal sent in between is never lost. Returns true if retry succeeded.
+  template <typename Retry>
+  bool park(std::atomic<uint32_t>& event, std::atomic<uint32_t>& waiting, Retry retry) {
+    uint32_t observed = event.load(std::memory_order_acquire);
+    waiting.fetch_add(1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    bool succeeded = retry();
+    if (!succeeded && !finished_.load(std::memory_order_acquire)) {
+      event.wait(observed, std::memory_order_acquire);
+    }
+    waiting.fetch_sub(1, std::memory_order_relaxed);
+    return succeeded;
+  }
+
+  std::unique_ptr<Cell[]> cells_;
+  size_t capacity_;
+  size_t mask_;
+
+  alignas(64) std::atomic<size_t> enqueue_pos_{0};
+  alignas(64) std::atomic<size_t> dequeue_pos_{0};
+
+  alignas(64) std::atomic<uint32_t> not_empty_{0};
+  std::atomic<uint32_t> waiting_consumers_{0};
+  alignas(64) std::atomic<uint32_t> not_full_{0};
+  std::atomic<uint32_t> waiting_producers_{0};
+
+  std::atomic<bool> finished_{false};
+};
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// Chunk pool
+//////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Recycles drained chunks, so their vectors and strings keep the capacity of earlier rounds.
+// Chunks need a reset() that empties them without releasing memory.
+template <typename Chunk>
+class ChunkPool {
+ public:
+  explicit ChunkPool(size_t capacity) : free_chunks_(capacity) {}
+
+  Chunk acquire() {
+    Chunk chunk;
+    if (!free_chunks_.try_pop(chunk)) {
+      return Chunk{};
+    }
+    return chunk;
+  }
+
+  void release(Chunk&& chunk) {
+    chunk.reset();
+    // Drop the chunk if the pool is full
+    free_chunks_.try_push(chunk);
+  }
+
+ private:
+  BoundedMPMCQueue<Chunk> free_chunks_;
+};
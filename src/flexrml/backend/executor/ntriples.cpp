@@ -0,0 +1,48 @@
+#include "ntriples.h"
+
+// Length of the term starting at start, the term ends before the next space
+static size_t term_length(std::string_view line, size_t start) {
+  size_t i = start;
+  if (line[i] == '<') {
+    i = line.find('>', i);
+    return i == std::string_view::npos ? std::string_view::npos : i + 1 - start;
+  }
+  if (line[i] == '"') {
+    for (++i; i < line.size() && line[i] != '"'; ++i) {
+      if (line[i] == '\\') {
+        ++i;
+      }
+    }
+    if (i >= line.size()) {
+      return std::string_view::npos;
+    }
+    ++i;
+    // Language tag or datatype
+    if (i < line.size() && line[i] == '@') {
+      i = line.find(' ', i);
+    } else if (line.compare(i, 3, "^^<") == 0) {
+      i = line.find('>', i);
+      i = i == std::string_view::npos ? i : i + 1;
+    }
+    return i == std::string_view::npos ? i : i - start;
+  }
+  i = line.find(' ', i);
+  return i == std::string_view::npos ? i : i - start;
+}
+
+size_t split_ntriples_line(std::string_view line, std::array<std::string_view, 4>& terms) {
+  size_t count = 0;
+  size_t position = 0;
+  while (position < line.size() && line[position] != '.') {
+    if (count == terms.size()) {
+      return 0;
+    }
+    size_t length = term_length(line, position);
+    if (length == std::string_view::npos) {
+      return 0;
+    }
+    terms[count++] = line.substr(position, length);
+    position += length + 1;
+  }
+  return count >= 3 ? count : 0;
+}
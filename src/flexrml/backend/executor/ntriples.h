@@ -0,0 +1,9 @@
+#pragma once
+
+#include <array>
+#include <string_view>
+
+// Splits a generated N-Triples or N-Quads line into its terms, the terms keep their
+// N-Triples form. Returns the number of terms, 3 or 4 with a graph, or 0 if the line
+// is malformed.
+size_t split_ntriples_line(std::string_view line, std::array<std::string_view, 4>& terms);
@@ -0,0 +1,1076 @@
+#include "output_writer.h"
+
+#include <fcntl.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <zlib.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <unordered_map>
+
+#if __has_include(<zstd.h>) && defined(FLEXRML_ZSTD)
+#include <zstd.h>
+#define FLEXRML_HAS_ZSTD 1
+#endif
+
+#include "external_sort.h"
+#include "hdt_output.h"
+#include "ntriples.h"
+#include "resource_manager.h"
+#include "turtle_output.h"
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+// Written buffers kept for reuse by the plans
+constexpr size_t max_free_buffers = 8;
+
+// O_DIRECT writes are aligned to the logical block size of the device, 4 KiB covers all devices
+constexpr size_t direct_alignment = 4096;
+// Preallocation grows by at least this much beyond the written bytes
+constexpr size_t preallocation_step = 64 * 1024 * 1024;
+// Written pages are dropped from the page cache in ranges of this size
+constexpr size_t drop_behind_bytes = 32 * 1024 * 1024;
+
+// Output targets that are streamed instead of written to a file
+constexpr std::string_view stdout_output = "-";
+constexpr std::string_view socket_prefix = "unix:";
+
+static std::mutex settings_mutex;
+static OutputSettings output_settings;
+
+// Size with an optional K, M or G suffix
+static size_t parse_size(const std::string& key, const std::string& value) {
+  if (value.empty()) {
+    return 0;
+  }
+  try {
+    size_t end = 0;
+    size_t size = std::stoull(value, &end);
+    std::string unit = value.substr(end);
+    if (unit == "K" || unit == "k") {
+      size <<= 10;
+    } else if (unit == "M" || unit == "m") {
+      size <<= 20;
+    } else if (unit == "G" || unit == "g") {
+      size <<= 30;
+    } else if (!unit.empty()) {
+      throw std::invalid_argument(unit);
+    }
+    return size;
+  } catch (const std::exception&) {
+    std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+    std::exit(1);
+  }
+}
+
+bool parse_output_option(const std::string& key, const std::string& value, OutputSettings& settings) {
+  if (key == "output_format") {
+    if (value.empty() || value == "nt") {
+      settings.format = OutputFormat::ntriples;
+    } else if (value == "hdt") {
+      settings.format = OutputFormat::hdt;
+    } else if (value == "ttl") {
+      settings.format = OutputFormat::turtle;
+    } else {
+      std::cout << "Error: Unknown output format. Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "turtle_prefixes") {
+    settings.turtle_prefixes.clear();
+    for (const auto& prefix : split_by_substring(value, " ")) {
+      if (!prefix.empty()) {
+        settings.turtle_prefixes.push_back(prefix);
+      }
+    }
+  } else if (key == "compression") {
+    if (value.empty() || value == "none") {
+      settings.compression = OutputCompression::none;
+    } else if (value == "gzip") {
+      settings.compression = OutputCompression::gzip;
+    } else if (value == "zstd") {
+#ifdef FLEXRML_HAS_ZSTD
+      settings.compression = OutputCompression::zstd;
+#else
+      std::cout << "Error: zstd compression is not available, flexrml was built without libzstd." << std::endl;
+      std::exit(1);
+#endif
+    } else {
+      std::cout << "Error: Unknown compression. Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "output_cache") {
+    if (value.empty() || value == "keep") {
+      settings.cache = OutputCache::keep;
+    } else if (value == "drop") {
+      settings.cache = OutputCache::drop;
+    } else if (value == "direct") {
+      settings.cache = OutputCache::direct;
+    } else {
+      std::cout << "Error: Unknown output cache mode. Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "preallocate") {
+    settings.preallocate = value == "true";
+  } else if (key == "sorted_output") {
+    settings.sorted = value == "true";
+  } else if (key == "sort_dedup") {
+    settings.sort_dedup = value == "true";
+  } else if (key == "sort_directory") {
+    settings.sort_directory = value;
+  } else if (key == "sort_memory") {
+    try {
+      // MiB
+      settings.sort_memory = value.empty() ? OutputSettings().sort_memory : std::stoull(value) * 1024 * 1024;
+    } catch (const std::exception&) {
+      std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "rotate_bytes") {
+    settings.rotate_bytes = parse_size(key, value);
+  } else if (key == "rotate_triples") {
+    try {
+      settings.rotate_triples = value.empty() ? 0 : std::stoull(value);
+    } catch (const std::exception&) {
+      std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "route_graphs") {
+    settings.route_graphs = value == "true";
+  } else if (key == "graph_sinks") {
+    try {
+      settings.graph_sinks = value.empty() ? OutputSettings().graph_sinks : std::max<size_t>(std::stoull(value), 1);
+    } catch (const std::exception&) {
+      std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else if (key == "compression_level") {
+    try {
+      settings.compression_level = value.empty() ? 0 : std::stoi(value);
+    } catch (const std::exception&) {
+      std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+      std::exit(1);
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
+
+void configure_output(const OutputSettings& settings) {
+  std::lock_guard<std::mutex> lock(settings_mutex);
+  output_settings = settings;
+}
+
+OutputSettings output_configuration() {
+  std::lock_guard<std::mutex> lock(settings_mutex);
+  return output_settings;
+}
+
+// Start of the extensions of a file name, a leading dot belongs to the name
+static size_t extensions_start(const std::string& name) { return std::min(name.find('.', 1), name.size()); }
+
+std::string insert_before_extensions(const std::string& output_file, char separator, const std::string& part) {
+  fs::path path(output_file);
+  std::string name = path.filename().string();
+  size_t extensions = extensions_start(name);
+  std::string inserted = name.substr(0, extensions) + separator + part + name.substr(extensions);
+  return (path.parent_path() / inserted).string();
+}
+
+std::string replace_extensions(const std::string& output_file, const std::string& extensions) {
+  fs::path path(output_file);
+  std::string name = path.filename().string();
+  return (path.parent_path() / (name.substr(0, extensions_start(name)) + extensions)).string();
+}
+
+std::string rotated_output_path(const std::string& output_file, size_t index) {
+  return insert_before_extensions(output_file, '.', std::to_string(index));
+}
+
+std::string graph_output_path(const std::string& output_file, std::string_view graph) {
+  constexpr size_t max_name_length = 32;
+  std::string_view iri = graph;
+  if (iri.size() >= 2 && iri.front() == '<') {
+    iri = iri.substr(1, iri.size() - 2);
+  }
+  size_t last_separator = iri.find_last_of("/#:");
+  if (last_separator != std::string_view::npos) {
+    iri = iri.substr(last_separator + 1);
+  }
+
+  std::string name;
+  for (char c : iri) {
+    if (name.size() == max_name_length) {
+      break;
+    }
+    bool plain = (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+    name += plain ? c : '_';
+  }
+  if (name.empty()) {
+    name = "graph";
+  }
+  char hash[16];
+  std::snprintf(hash, sizeof(hash), "%08x", static_cast<uint32_t>(XXH3_64bits(graph.data(), graph.size())));
+  return insert_before_extensions(output_file, '-', name + "-" + hash);
+}
+
+// Run files of a sorted output are placed next to the output file, of streams in the temporary
+// directory. The process id and a counter keep the runs of concurrent writers apart.
+static std::string sort_run_prefix(const fs::path& path, const OutputSettings& settings) {
+  static std::atomic<size_t> sorted_outputs{0};
+  fs::path directory = settings.sort_directory;
+  if (directory.empty()) {
+    directory = is_stream_output(path.string()) ? fs::temp_directory_path() : path.parent_path();
+  }
+  if (directory.empty()) {
+    directory = ".";
+  }
+  fs::create_directories(directory);
+  std::string name = ".flexrml-sort-" + std::to_string(::getpid()) + "-" + std::to_string(sorted_outputs++);
+  return (directory / name).string();
+}
+
+OutputWriter::OutputWriter(const fs::path& path, size_t memory_cap, bool graph_sink)
+    : base_path_(path.string()), path_(path.string()), memory_cap_(memory_cap) {
+  settings_ = output_configuration();
+  // The writer of the default graph and the graph sinks share the sort memory
+  if (settings_.route_graphs) {
+    settings_.sort_memory /= settings_.graph_sinks + 1;
+  }
+  settings_.route_graphs = settings_.route_graphs && !graph_sink;
+  if (settings_.format == OutputFormat::hdt) {
+    encoder_ = std::make_unique<HdtEncoder>();
+  } else if (settings_.sorted) {
+    // The plans blocked while a run is sorted sort its slices with the writer thread
+    sorter_ = std::make_unique<ExternalSorter>(
+        sort_run_prefix(path, settings_), settings_.sort_memory, ResourceManager::instance().budget(), settings_.sort_dedup,
+        [this](size_t tasks, const std::function<void(size_t)>& task) { run_parallel(tasks, task); });
+  }
+  rotating_ = (settings_.rotate_bytes > 0 || settings_.rotate_triples > 0) && !is_stream_output(base_path_);
+  if (rotating_) {
+    path_ = rotated_output_path(base_path_, 0);
+  }
+  deferred_ = sorter_ || rotating_;
+  if (settings_.format == OutputFormat::turtle) {
+    turtle_ = std::make_unique<TurtleSerializer>(settings_.turtle_prefixes);
+    // The prefixes start the file, compressed like the statements. Deferred output writes
+    // them before the first statements of every file.
+    std::string header = turtle_->header();
+    if (deferred_) {
+      header_pending_ = true;
+    } else if (!header.empty()) {
+      pending_bytes_ += header.size();
+      pending_.push_back(std::move(header));
+    }
+  }
+
+  open_file(path_);
+  thread_ = std::thread(&OutputWriter::run, this);
+}
+
+// Path of the Unix domain socket an output is streamed to, empty if it is no socket
+static std::string socket_path(const std::string& path) {
+  if (path.rfind(socket_prefix, 0) == 0) {
+    return path.substr(socket_prefix.size());
+  }
+  struct stat info;
+  if (::stat(path.c_str(), &info) == 0 && S_ISSOCK(info.st_mode)) {
+    return path;
+  }
+  return "";
+}
+
+bool is_stream_output(const std::string& path) {
+  if (path == stdout_output || !socket_path(path).empty()) {
+    return true;
+  }
+  struct stat info;
+  return ::stat(path.c_str(), &info) == 0 && S_ISFIFO(info.st_mode);
+}
+
+void OutputWriter::open_file(const fs::path& path) {
+  if (is_stream_output(path_)) {
+    open_stream();
+    return;
+  }
+  if (path.has_parent_path()) {
+    fs::create_directories(path.parent_path());
+  }
+  // Rotated files belong to the writer alone, they start empty
+  int flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC | (rotating_ ? O_TRUNC : 0);
+  direct_ = settings_.cache == OutputCache::direct;
+  fd_ = ::open(path_.c_str(), flags | (direct_ ? O_DIRECT : 0), 0644);
+  if (fd_ < 0 && direct_ && errno == EINVAL) {
+    // The file system does not support O_DIRECT, e.g. tmpfs
+    direct_ = false;
+    fd_ = ::open(path_.c_str(), flags, 0644);
+  }
+  if (fd_ < 0) {
+    std::cerr << "Error: Unable to open file for writing. Got: " << path_ << std::endl;
+    std::exit(1);
+  }
+
+  struct stat info;
+  if (::fstat(fd_, &info) == 0) {
+    file_start_ = info.st_size;
+  }
+  // Appending with O_DIRECT needs an aligned end of file
+  if (direct_ && file_start_ % direct_alignment != 0) {
+    direct_ = false;
+    ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+  }
+  if (direct_) {
+    direct_block_.reset(static_cast<char*>(std::aligned_alloc(direct_alignment, direct_block_size)));
+  }
+  drop_cache_ = settings_.cache != OutputCache::keep && !direct_;
+  reserved_ = file_start_;
+  flushed_ = file_start_;
+  dropped_ = file_start_;
+}
+
+// Streams are written as the buffers arrive, the space and page cache handling of files
+// does not apply. Opening a named pipe waits for its reader.
+void OutputWriter::open_stream() {
+  std::string socket = socket_path(path_);
+  if (path_ == stdout_output) {
+    fd_ = ::fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 0);
+  } else if (!socket.empty()) {
+    sockaddr_un address{};
+    address.sun_family = AF_UNIX;
+    if (socket.size() < sizeof(address.sun_path)) {
+      std::memcpy(address.sun_path, socket.c_str(), socket.size() + 1);
+      fd_ = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+      if (fd_ >= 0 && ::connect(fd_, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+        ::close(fd_);
+        fd_ = -1;
+      }
+    }
+  } else {
+    fd_ = ::open(path_.c_str(), O_WRONLY | O_CLOEXEC);
+  }
+  if (fd_ < 0) {
+    std::cerr << "Error: Unable to open output stream. Got: " << path_ << std::endl;
+    std::exit(1);
+  }
+  settings_.preallocate = false;
+}
+
+OutputWriter::~OutputWriter() { close(); }
+
+std::vector<OutputFileStats> OutputWriter::close() {
+  if (thread_.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      stop_ = true;
+    }
+    work_available_.notify_one();
+    thread_.join();
+    finish_file();
+    ::close(fd_);
+    closed_files_.push_back({path_, bytes_written_, rotating_ ? file_lines_ : lines_written_, write_seconds_, {}});
+
+    std::lock_guard<std::mutex> lock(graph_mutex_);
+    while (!graph_sinks_.empty()) {
+      close_graph_sink(graph_sinks_.begin()->first);
+    }
+    // Rotated graph files were added by their sinks
+    for (auto& [graph, stats] : graph_files_) {
+      if (!rotating_) {
+        closed_files_.push_back(std::move(stats));
+      }
+    }
+    graph_files_.clear();
+  }
+  return closed_files_;
+}
+
+// Close the current rotated file and continue in the next one
+void OutputWriter::rotate() {
+  finish_encoding();
+  finish_file();
+  ::close(fd_);
+  closed_files_.push_back({path_, bytes_written_, file_lines_, write_seconds_, {}});
+
+  closed_content_ = content_in_;
+  closed_bytes_ += bytes_written_;
+  bytes_written_ = 0;
+  write_seconds_ = 0;
+  file_lines_ = 0;
+  file_content_ = 0;
+  path_ = rotated_output_path(base_path_, ++file_index_);
+  if (settings_.format == OutputFormat::hdt) {
+    encoder_ = std::make_unique<HdtEncoder>();
+  }
+  header_pending_ = turtle_ != nullptr;
+  open_file(path_);
+}
+
+// Write the staged tail of O_DIRECT writes, release the preallocated space after the end
+// of the file and drop the last written pages
+void OutputWriter::finish_file() {
+  auto start = std::chrono::steady_clock::now();
+  if (direct_ && staged_ > 0) {
+    // The tail is not a multiple of the block size, it goes through the page cache
+    ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) & ~O_DIRECT);
+    write_fully(direct_block_.get(), staged_);
+    staged_ = 0;
+    drop_cache_ = true;
+  }
+
+  // Truncating to the current size frees the blocks allocated after the end
+  size_t end = file_start_ + bytes_written_;
+  if (reserved_ > end && ::ftruncate(fd_, end) != 0) {
+    std::cerr << "Warning: Unable to release preallocated space of " << path_ << std::endl;
+  }
+  if (drop_cache_) {
+    drop_written_pages(true);
+  }
+  write_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OutputWriter::write(std::string& buffer) {
+  if (buffer.empty()) {
+    return;
+  }
+  if (settings_.route_graphs) {
+    route_graphs(buffer);
+    if (buffer.empty()) {
+      return;
+    }
+  }
+  size_t lines = std::count(buffer.begin(), buffer.end(), '\n');
+
+  // Turtle is serialized by the calling plans, the buffer keeps its capacity. Deferred output
+  // is serialized by the writer thread.
+  std::string statements;
+  bool convert = turtle_ && !deferred_;
+  if (convert) {
+    turtle_->convert(buffer, statements);
+    buffer.clear();
+  }
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  // Back-pressure, a single buffer larger than the cap is still accepted. The waiting plan
+  // helps the writer thread with its parallel work meanwhile.
+  while (pending_bytes_ >= memory_cap_) {
+    if (shared_work_ != nullptr && shared_work_->next < shared_work_->tasks) {
+      work_on(*shared_work_, lock);
+    } else {
+      space_available_.wait(lock);
+    }
+  }
+  if (!deferred_) {
+    lines_written_ += lines;
+  }
+  if (convert) {
+    pending_bytes_ += statements.size();
+    pending_.push_back(std::move(statements));
+    lock.unlock();
+    work_available_.notify_one();
+    return;
+  }
+  pending_bytes_ += buffer.size();
+  pending_.push_back(std::move(buffer));
+
+  buffer.clear();
+  if (!free_buffers_.empty()) {
+    buffer.swap(free_buffers_.back());
+    free_buffers_.pop_back();
+  }
+  lock.unlock();
+  work_available_.notify_one();
+}
+
+// Hand the quads of buffer to the sinks of their graphs without the graph term, the triples
+// of the default graph stay in buffer
+void OutputWriter::route_graphs(std::string& buffer) {
+  std::string_view data(buffer);
+  std::array<std::string_view, 4> terms;
+  std::unordered_map<std::string_view, std::string> quads_of_graph;
+  std::string triples;
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    line_end = line_end == std::string_view::npos ? data.size() : line_end + 1;
+    std::string_view line = data.substr(line_start, line_end - line_start);
+    line_start = line_end;
+
+    if (split_ntriples_line(line, terms) != 4) {
+      triples += line;
+      continue;
+    }
+    std::string& quads = quads_of_graph[terms[3]];
+    // The graph term follows the object, the line keeps the text up to the object
+    quads.append(line.data(), terms[2].data() + terms[2].size() - line.data());
+    quads += " .\n";
+  }
+  if (quads_of_graph.empty()) {
+    return;
+  }
+
+  // Only the lookup holds graph_mutex_, plans hand over the quads of different graphs at once.
+  // A sink closed in between leaves the quads, they go to the sink opened again.
+  for (auto& [graph, quads] : quads_of_graph) {
+    while (!quads.empty()) {
+      std::shared_ptr<GraphSink> sink;
+      {
+        std::lock_guard<std::mutex> lock(graph_mutex_);
+        sink = graph_sink(std::string(graph));
+      }
+      std::lock_guard<std::mutex> sink_lock(sink->mutex);
+      if (sink->writer) {
+        sink->writer->write(quads);
+      }
+    }
+  }
+  buffer.swap(triples);
+}
+
+// Writer of the file of a graph. A graph file is truncated when it is first used in an execution,
+// a sink opened again appends. Sorted, rotated and binary files cannot be appended to, their sinks
+// stay open and more graphs than sinks are an error. Called under graph_mutex_.
+std::shared_ptr<OutputWriter::GraphSink> OutputWriter::graph_sink(const std::string& graph) {
+  auto it = graph_sinks_.find(graph);
+  if (it != graph_sinks_.end()) {
+    it->second->last_use = ++graph_uses_;
+    return it->second;
+  }
+
+  bool appendable = settings_.format != OutputFormat::hdt && !settings_.sorted && !rotating_;
+  if (!appendable && graph_sinks_.size() >= settings_.graph_sinks) {
+    std::cout << "Error: Sorted, rotated and hdt graph files stay open until the end, the output has more than "
+              << settings_.graph_sinks << " named graphs. Raise --graph-sinks." << std::endl;
+    std::exit(1);
+  }
+  if (graph_sinks_.size() >= settings_.graph_sinks) {
+    auto least_recent = std::min_element(graph_sinks_.begin(), graph_sinks_.end(), [](const auto& a, const auto& b) {
+      return a.second->last_use < b.second->last_use;
+    });
+    close_graph_sink(least_recent->first);
+  }
+
+  std::string path = graph_output_path(base_path_, graph);
+  if (graph_files_.find(graph) == graph_files_.end()) {
+    graph_files_[graph] = {path, 0, 0, 0, graph};
+    if (!rotating_ && ::truncate(path.c_str(), 0) != 0 && errno != ENOENT) {
+      std::cerr << "Error: Unable to truncate graph output " << path << ": " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+  }
+  auto sink = std::make_shared<GraphSink>();
+  sink->writer = std::make_unique<OutputWriter>(path, graph_sink_memory_cap, true);
+  sink->last_use = ++graph_uses_;
+  graph_sinks_[graph] = sink;
+  return sink;
+}
+
+// Close the writer of a graph once the writes in flight are handed over, what it wrote is added
+// to the file of the graph. Called under graph_mutex_.
+void OutputWriter::close_graph_sink(const std::string& graph) {
+  auto it = graph_sinks_.find(graph);
+  GraphSink& sink = *it->second;
+  std::lock_guard<std::mutex> sink_lock(sink.mutex);
+  OutputFileStats& file = graph_files_[graph];
+  for (const auto& written : sink.writer->close()) {
+    if (written.path != file.path) {
+      closed_files_.push_back(written);  // a rotated file of the graph
+      closed_files_.back().graph = graph;
+      continue;
+    }
+    file.bytes += written.bytes;
+    file.lines += written.lines;
+    file.write_seconds += written.write_seconds;
+  }
+  sink.writer.reset();
+  graph_sinks_.erase(it);  // graph may be the key of the entry
+}
+
+void OutputWriter::run() {
+  std::vector<std::string> buffers;
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    work_available_.wait(lock, [this] { return stop_ || !pending_.empty(); });
+    if (pending_.empty()) {
+      break;  // stopped and drained
+    }
+
+    // Take all pending buffers, plans fill new ones meanwhile
+    buffers.swap(pending_);
+    lock.unlock();
+
+    size_t taken = 0;
+    for (const auto& buffer : buffers) {
+      taken += buffer.size();
+    }
+    if (sorter_) {
+      // The run may be spilled meanwhile, the plans wait for the space of the taken buffers
+      for (auto& buffer : buffers) {
+        sorter_->add(std::move(buffer));
+      }
+    } else {
+      emit(buffers);
+    }
+
+    lock.lock();
+    pending_bytes_ -= taken;
+    for (auto& buffer : buffers) {
+      if (free_buffers_.size() == max_free_buffers) {
+        break;
+      }
+      buffer.clear();
+      free_buffers_.push_back(std::move(buffer));
+    }
+    buffers.clear();
+    space_available_.notify_all();
+  }
+  lock.unlock();
+
+  if (sorter_) {
+    std::vector<std::string> sorted(1);
+    sorter_->finish([&](std::string& lines) {
+      sorted[0].swap(lines);
+      emit(sorted);
+    });
+    sorter_.reset();  // removes the run files
+  }
+  if (header_pending_) {
+    std::vector<std::string> no_triples;
+    append_to_file(no_triples);  // a Turtle file of the prefixes only
+  }
+  finish_encoding();
+}
+
+// The binary file needs all triples, it is not compressed further
+void OutputWriter::finish_encoding() {
+  if (encoder_) {
+    std::vector<std::string> encoded{encoder_->serialize()};
+    encoder_.reset();
+    write_all(encoded);
+  } else if (settings_.compression != OutputCompression::none) {
+    compress_and_write({}, true);
+  }
+}
+
+// Hand N-Triples buffers to the current file. With rotation the buffers are cut at the line
+// end where the current file is full, the rest goes to the next file.
+void OutputWriter::emit(std::vector<std::string>& buffers) {
+  if (!rotating_) {
+    if (deferred_) {
+      for (const auto& buffer : buffers) {
+        lines_written_ += std::count(buffer.begin(), buffer.end(), '\n');
+      }
+    }
+    append_to_file(buffers);
+    return;
+  }
+
+  std::vector<std::string> batch;
+  for (auto& buffer : buffers) {
+    size_t start = 0;
+    while (start < buffer.size()) {
+      size_t lines = 0;
+      size_t end = rotation_cut(buffer, start, lines);
+      if (end == start) {
+        bool measured = encoded_ratio() > 0;
+        append_to_file(batch);
+        batch.clear();
+        // The first file is measured on the bytes it wrote before it is cut
+        if (!measured && !encoder_) {
+          if (settings_.compression != OutputCompression::none) {
+            compress_and_write({}, true);
+          }
+          if (rotation_cut(buffer, start, lines) != start) {
+            continue;
+          }
+        }
+        rotate();
+        continue;
+      }
+
+      size_t length = end - start;
+      if (length == buffer.size()) {
+        batch.push_back(std::move(buffer));
+      } else {
+        batch.push_back(buffer.substr(start, length));
+      }
+      file_lines_ += lines;
+      file_content_ += length;
+      lines_written_ += lines;
+      start = end;
+    }
+  }
+  append_to_file(batch);
+}
+
+// Bytes written per N-Triples byte, 0 while nothing is written. Content still in the encoder
+// or in the block not yet compressed is not counted.
+double OutputWriter::encoded_ratio() const {
+  size_t pending = settings_.compression != OutputCompression::none ? block_.size() : 0;
+  size_t encoded = encoder_ ? closed_content_ : content_in_ - std::min(pending, content_in_);
+  size_t written = closed_bytes_ + bytes_written_;
+  return encoded == 0 || written == 0 ? 0 : static_cast<double>(written) / encoded;
+}
+
+// End of the lines from start that still fit into the current file, a file gets at least
+// one line. lines is set to their number. The rotation size is converted to N-Triples bytes
+// by the ratio of the encoding, before anything is written it counts N-Triples bytes.
+size_t OutputWriter::rotation_cut(const std::string& buffer, size_t start, size_t& lines) const {
+  double ratio = encoded_ratio();
+  size_t content_limit = ratio > 0 ? static_cast<size_t>(settings_.rotate_bytes / ratio) : settings_.rotate_bytes;
+  size_t end = start;
+  lines = 0;
+  while (end < buffer.size()) {
+    bool file_empty = file_lines_ + lines == 0;
+    if (!file_empty && settings_.rotate_triples > 0 && file_lines_ + lines >= settings_.rotate_triples) {
+      break;
+    }
+    size_t line_end = buffer.find('\n', end);
+    line_end = line_end == std::string::npos ? buffer.size() : line_end + 1;
+    if (!file_empty && settings_.rotate_bytes > 0 && file_content_ + (line_end - start) > content_limit) {
+      break;
+    }
+    end = line_end;
+    lines++;
+  }
+  return end;
+}
+
+void OutputWriter::append_to_file(std::vector<std::string>& buffers) {
+  for (const auto& buffer : buffers) {
+    content_in_ += buffer.size();
+  }
+  std::vector<std::string> statements;
+  bool convert = turtle_ && deferred_;
+  if (convert) {
+    if (header_pending_ && !turtle_->header().empty()) {
+      statements.push_back(turtle_->header());
+    }
+    header_pending_ = false;
+    for (const auto& buffer : buffers) {
+      statements.emplace_back();
+      turtle_->convert(buffer, statements.back());
+    }
+  }
+  std::vector<std::string>& content = convert ? statements : buffers;
+
+  if (encoder_) {
+    for (const auto& buffer : content) {
+      encoder_->add(buffer);
+    }
+  } else if (settings_.compression == OutputCompression::none) {
+    write_all(content);
+  } else {
+    compress_and_write(content, false);
+  }
+}
+
+// Cut the buffers into blocks ending at a line end, compress the blocks in parallel and append
+// them in order. The rest after the last full block starts the next block, unless flushed.
+void OutputWriter::compress_and_write(const std::vector<std::string>& buffers, bool flush) {
+  std::vector<std::string> blocks;
+  for (const auto& buffer : buffers) {
+    block_ += buffer;
+    size_t start = 0;
+    while (block_.size() - start >= compression_block_size) {
+      size_t end = block_.rfind('\n', start + compression_block_size - 1);
+      if (end == std::string::npos || end < start) {
+        end = block_.find('\n', start + compression_block_size);  // line longer than a block
+        if (end == std::string::npos) {
+          break;
+        }
+      }
+      blocks.push_back(block_.substr(start, end + 1 - start));
+      start = end + 1;
+    }
+    block_.erase(0, start);
+  }
+  // An empty file is no valid gzip file, it gets an empty member
+  if (flush && (!block_.empty() || bytes_written_ == 0)) {
+    blocks.push_back(std::move(block_));
+    block_.clear();
+  }
+  if (blocks.empty()) {
+    return;
+  }
+
+  std::vector<std::string> compressed(blocks.size());
+  run_parallel(blocks.size(), [&](size_t i) { compressed[i] = compress_block(blocks[i]); });
+  write_all(compressed);
+}
+
+// Run task(0) ... task(tasks - 1) on the writer thread, the plans blocked on back-pressure and
+// the helpers the budget has spare. While the workers lease the whole budget only the writer
+// thread and the blocked plans, whose CPUs would idle otherwise, run the tasks.
+void OutputWriter::run_parallel(size_t tasks, const std::function<void(size_t)>& task) {
+  SharedWork work{&task, tasks};
+  std::unique_lock<std::mutex> lock(mutex_);
+  shared_work_ = &work;
+  space_available_.notify_all();
+  lock.unlock();
+
+  // Every thread of the pool runs tasks until none is left to start
+  HelperPool::instance().run(tasks, [this, &work](size_t) {
+    std::unique_lock<std::mutex> helper_lock(mutex_);
+    work_on(work, helper_lock);
+  });
+
+  lock.lock();
+  work_finished_.wait(lock, [&work] { return work.finished == work.tasks && work.workers == 0; });
+  shared_work_ = nullptr;
+}
+
+// Run tasks of the work until none is left to start, called and returns with mutex_ locked
+void OutputWriter::work_on(SharedWork& work, std::unique_lock<std::mutex>& lock) {
+  ++work.workers;
+  while (work.next < work.tasks) {
+    size_t index = work.next++;
+    lock.unlock();
+    (*work.task)(index);
+    lock.lock();
+    ++work.finished;
+  }
+  --work.workers;
+  work_finished_.notify_all();
+}
+
+std::string OutputWriter::compress_block(const std::string& block) const {
+  std::string compressed;
+#ifdef FLEXRML_HAS_ZSTD
+  if (settings_.compression == OutputCompression::zstd) {
+    int level = settings_.compression_level == 0 ? ZSTD_CLEVEL_DEFAULT : settings_.compression_level;
+    compressed.resize(ZSTD_compressBound(block.size()));
+    size_t size = ZSTD_compress(compressed.data(), compressed.size(), block.data(), block.size(), level);
+    if (ZSTD_isError(size)) {
+      std::cerr << "Error: Compressing " << path_ << " failed: " << ZSTD_getErrorName(size) << std::endl;
+      std::exit(1);
+    }
+    compressed.resize(size);
+    return compressed;
+  }
+#endif
+
+  // Every block is a complete gzip member
+  int level = settings_.compression_level == 0 ? Z_DEFAULT_COMPRESSION : settings_.compression_level;
+  z_stream stream{};
+  if (deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    std::cerr << "Error: Compressing " << path_ << " failed: invalid compression level " << level << std::endl;
+    std::exit(1);
+  }
+  compressed.resize(deflateBound(&stream, block.size()));
+  stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(block.data()));
+  stream.avail_in = static_cast<uInt>(block.size());
+  stream.next_out = reinterpret_cast<Bytef*>(compressed.data());
+  stream.avail_out = static_cast<uInt>(compressed.size());
+  int status = deflate(&stream, Z_FINISH);
+  deflateEnd(&stream);
+  if (status != Z_STREAM_END) {
+    std::cerr << "Error: Compressing " << path_ << " failed." << std::endl;
+    std::exit(1);
+  }
+  compressed.resize(stream.total_out);
+  return compressed;
+}
+
+void OutputWriter::write_all(std::vector<std::string>& buffers) {
+  auto start = std::chrono::steady_clock::now();
+  size_t incoming = 0;
+  for (const auto& buffer : buffers) {
+    incoming += buffer.size();
+  }
+
+  preallocate(incoming);
+  if (direct_) {
+    write_direct(buffers);
+  } else {
+    write_vectors(buffers);
+  }
+  bytes_written_ += incoming;
+  if (drop_cache_) {
+    drop_written_pages(false);
+  }
+  write_seconds_ += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Append the buffers with as few writev calls as possible, resuming after partial writes
+void OutputWriter::write_vectors(std::vector<std::string>& buffers) {
+  std::vector<iovec> vectors;
+  vectors.reserve(buffers.size());
+  for (auto& buffer : buffers) {
+    vectors.push_back({buffer.data(), buffer.size()});
+  }
+
+  size_t first = 0;
+  while (first < vectors.size()) {
+    int count = static_cast<int>(std::min<size_t>(vectors.size() - first, IOV_MAX));
+    ssize_t written = ::writev(fd_, vectors.data() + first, count);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Error: Writing " << path_ << " failed: " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+
+    // Skip the fully written buffers and advance into a partially written one
+    size_t remaining = static_cast<size_t>(written);
+    while (first < vectors.size() && remaining >= vectors[first].iov_len) {
+      remaining -= vectors[first].iov_len;
+      first++;
+    }
+    if (first < vectors.size()) {
+      vectors[first].iov_base = static_cast<char*>(vectors[first].iov_base) + remaining;
+      vectors[first].iov_len -= remaining;
+    }
+  }
+}
+
+// Copy the buffers into the aligned staging block, full blocks are written with O_DIRECT
+void OutputWriter::write_direct(const std::vector<std::string>& buffers) {
+  for (const auto& buffer : buffers) {
+    size_t offset = 0;
+    while (offset < buffer.size()) {
+      size_t copied = std::min(buffer.size() - offset, direct_block_size - staged_);
+      std::memcpy(direct_block_.get() + staged_, buffer.data() + offset, copied);
+      staged_ += copied;
+      offset += copied;
+      if (staged_ == direct_block_size) {
+        write_fully(direct_block_.get(), direct_block_size);
+        staged_ = 0;
+      }
+    }
+  }
+}
+
+void OutputWriter::write_fully(const char* data, size_t size) {
+  while (size > 0) {
+    ssize_t written = ::write(fd_, data, size);
+    if (written < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      std::cerr << "Error: Writing " << path_ << " failed: " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+    data += written;
+    size -= written;
+  }
+}
+
+// Reserve disk space ahead of the writes, at least the expected size of the file. The file
+// size is kept, the space after the end is released when the file is closed.
+void OutputWriter::preallocate(size_t incoming) {
+  if (!settings_.preallocate) {
+    return;
+  }
+  size_t needed = file_start_ + bytes_written_ + incoming;
+  if (needed <= reserved_) {
+    return;
+  }
+
+  // A rotated file holds at most the rotation size
+  size_t expected = rotating_ && settings_.rotate_bytes > 0 ? std::min(expected_bytes_.load(), settings_.rotate_bytes) : expected_bytes_.load();
+  size_t target = std::max(needed + std::max(preallocation_step, needed / 4), file_start_ + expected);
+  if (::fallocate(fd_, FALLOC_FL_KEEP_SIZE, reserved_, target - reserved_) != 0) {
+    settings_.preallocate = false;  // not supported by the file system
+    return;
+  }
+  reserved_ = target;
+}
+
+// Drop written pages behind the writer. Writeback of the newly written range is started,
+// the range started before is written by now and its pages are dropped from the cache.
+void OutputWriter::drop_written_pages(bool final) {
+  size_t end = file_start_ + bytes_written_ - staged_;
+  if (!final && end - flushed_ < drop_behind_bytes) {
+    return;
+  }
+
+  if (flushed_ > dropped_) {
+    ::sync_file_range(fd_, dropped_, flushed_ - dropped_,
+                      SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+    ::posix_fadvise(fd_, dropped_, flushed_ - dropped_, POSIX_FADV_DONTNEED);
+    dropped_ = flushed_;
+  }
+  ::sync_file_range(fd_, flushed_, end - flushed_, SYNC_FILE_RANGE_WRITE);
+  flushed_ = end;
+
+  if (final) {
+    ::fdatasync(fd_);
+    ::posix_fadvise(fd_, dropped_, 0, POSIX_FADV_DONTNEED);
+    dropped_ = end;
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+using WriterMap = std::unordered_map<std::string, std::unique_ptr<OutputWriter>>;
+
+static std::mutex writers_mutex;
+// Never destroyed, a writer thread may call exit on a failed write
+static WriterMap& writers = *new WriterMap();
+
+OutputWriter& output_writer(const fs::path& path) {
+  std::lock_guard<std::mutex> lock(writers_mutex);
+  std::unique_ptr<OutputWriter>& writer = writers[path.string()];
+  if (!writer) {
+    writer = std::make_unique<OutputWriter>(path);
+  }
+  return *writer;
+}
+
+void expect_output_bytes(const fs::path& path, size_t bytes) {
+  OutputSettings settings = output_configuration();
+  if (!settings.preallocate || settings.format != OutputFormat::ntriples || settings.compression != OutputCompression::none) {
+    return;
+  }
+  output_writer(path).expect_bytes(bytes);
+}
+
+static std::string write_stats;
+
+std::vector<OutputFileStats> close_output_writers() {
+  WriterMap closing;
+  {
+    std::lock_guard<std::mutex> lock(writers_mutex);
+    closing.swap(writers);
+  }
+
+  std::vector<OutputFileStats> written;
+  for (auto& [path, writer] : closing) {
+    for (auto& file : writer->close()) {
+      written.push_back(std::move(file));
+    }
+  }
+
+  std::ostringstream stats;
+  stats << std::fixed << std::setprecision(3);
+  for (const auto& file : written) {
+    double megabytes = file.bytes / (1024.0 * 1024.0);
+    double bandwidth = file.write_seconds > 0 ? megabytes / file.write_seconds : 0;
+    stats << "path===" << file.path << "|||triples===" << file.lines << "|||megabytes===" << megabytes
+          << "|||seconds===" << file.write_seconds
+          << "|||bandwidth===" << bandwidth << "\n";
+  }
+  write_stats = stats.str();
+  return written;
+}
+
+extern "C" {
+const char* output_write_stats() { return write_stats.c_str(); }
+}
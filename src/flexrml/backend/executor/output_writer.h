@@ -0,0 +1,248 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdlib>
+#include <filesystem>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+class ExternalSorter;
+class HdtEncoder;
+class TurtleSerializer;
+
+// Codec of the output files. Compressed files are a sequence of independent gzip members
+// or zstd frames, which the standard tools decompress as one stream.
+enum class OutputCompression { none, gzip, zstd };
+
+// Format of the output files: N-Triples, the binary dictionary encoded format of hdt_output.h
+// or Turtle with the prefixes given as executor option
+enum class OutputFormat { ntriples, hdt, turtle };
+
+// Page cache use of the output files. drop writes through the page cache and drops written
+// pages behind the writer, direct bypasses the cache with O_DIRECT and aligned writes.
+enum class OutputCache { keep, drop, direct };
+
+// Settings of the output files, given as executor options
+struct OutputSettings {
+  OutputFormat format = OutputFormat::ntriples;
+  std::vector<std::string> turtle_prefixes;  // namespaces of the @prefix declarations
+  OutputCompression compression = OutputCompression::none;
+  int compression_level = 0;  // 0 = default level of the codec
+  OutputCache cache = OutputCache::keep;
+  bool preallocate = false;  // reserve disk space ahead of the writes with fallocate
+  bool sorted = false;       // lines sorted by subject, not for the binary format
+  bool sort_dedup = false;   // duplicate lines are removed while the sorted runs are merged
+  size_t sort_memory = 1024 * 1024 * 1024;  // bytes of a sorted run before it is spilled
+  std::string sort_directory;  // of the run files, empty = next to the output file
+  size_t rotate_bytes = 0;    // start the next file after about this many bytes written, 0 = never
+  size_t rotate_triples = 0;  // start the next file after this many triples, 0 = never
+  bool route_graphs = false;  // quads go to a file per graph, without the graph term
+  size_t graph_sinks = 64;    // graph files open at once
+};
+
+// Returns true if key is an output option and stores its value in settings.
+bool parse_output_option(const std::string& key, const std::string& value, OutputSettings& settings);
+
+// Settings of the writers opened from here on.
+void configure_output(const OutputSettings& settings);
+OutputSettings output_configuration();
+
+// out.nt.gz -> out<separator><part>.nt.gz, files derived from the output file are named
+// before all its extensions
+std::string insert_before_extensions(const std::string& output_file, char separator, const std::string& part);
+// out.nt.gz -> out<extensions>
+std::string replace_extensions(const std::string& output_file, const std::string& extensions);
+
+// Rotated output files of out.nt are out.0.nt, out.1.nt, ... the number goes before all
+// extensions, out.nt.gz -> out.0.nt.gz.
+std::string rotated_output_path(const std::string& output_file, size_t index);
+
+// File of a named graph with graph routing, out.nt -> out-<local name>-<hash>.nt. The local
+// name of the graph IRI keeps the name readable, the hash of the graph term unique.
+std::string graph_output_path(const std::string& output_file, std::string_view graph);
+
+// Bytes written to an output file, the triples (N-Triples lines) handed to its writer
+// and the time spent writing
+struct OutputFileStats {
+  std::string path;
+  size_t bytes = 0;
+  size_t lines = 0;
+  double write_seconds = 0;
+  std::string graph;  // graph term of a routed graph file, empty otherwise
+};
+
+// Asynchronous writer of one output file. It owns the file descriptor, plans hand it their
+// filled buffers and continue, a writer thread appends the buffers with large writev calls.
+// Handing over a buffer only blocks while the buffers not yet written exceed the memory cap.
+// In the binary format the writer encodes the buffers and writes the file when it is closed.
+// With compression the writer cuts the output into blocks at line ends, compresses the blocks
+// in parallel and appends them in order. Plans blocked on back-pressure compress with the writer
+// thread, so the CPUs of the waiting workers are not idle, spare helpers of the budget join them.
+// Streams are written the same way, so memory stays bounded by the cap whatever the output size.
+// Sorted output is collected into runs by an external sort and written when the file is closed,
+// lines counts the lines after duplicates are removed. Runs are sorted in parallel like the
+// compressed blocks.
+// With rotation the writer closes the file after the configured bytes or triples and continues
+// in the next rotated file. Files end at line ends, Turtle files start with the prefixes and
+// binary files are encoded on their own. The size of Turtle and compressed files is estimated
+// from the bytes written per N-Triples byte so far, binary files from the files already closed.
+// With graph routing the writer hands the quads to a pool of writers of the graph files, keyed
+// by the graph term, and writes the triples of the default graph itself. The least recently
+// used graph file is closed when the pool is full and appended to when it is used again.
+// Sorted, rotated and binary graph files stay open, the writers split the sort memory.
+// With O_DIRECT the writer stages the output in aligned blocks, only the tail of the file is
+// written through the page cache when it is closed.
+class OutputWriter {
+ public:
+  static constexpr size_t default_memory_cap = 256 * 1024 * 1024;
+  static constexpr size_t compression_block_size = 1024 * 1024;
+  static constexpr size_t direct_block_size = 8 * 1024 * 1024;
+
+  static constexpr size_t graph_sink_memory_cap = 32 * 1024 * 1024;
+
+  // A graph sink is the writer of a routed graph file, it does not route itself.
+  explicit OutputWriter(const std::filesystem::path& path, size_t memory_cap = default_memory_cap,
+                        bool graph_sink = false);
+  ~OutputWriter();
+
+  OutputWriter(const OutputWriter&) = delete;
+  OutputWriter& operator=(const OutputWriter&) = delete;
+
+  // Hands the content of buffer to the writer. buffer is left empty with the capacity
+  // of a buffer written before, so the caller fills one buffer while the other is written.
+  void write(std::string& buffer);
+
+  // Expected size of the file, preallocated with the first write.
+  void expect_bytes(size_t bytes) { expected_bytes_ = bytes; }
+
+  // Writes the pending buffers and closes the file. Returns what was written to every file,
+  // more than one with rotation.
+  std::vector<OutputFileStats> close();
+
+ private:
+  struct FreeDeleter {
+    void operator()(char* block) const { std::free(block); }
+  };
+
+  void open_file(const std::filesystem::path& path);
+  void open_stream();
+  void run();
+  void emit(std::vector<std::string>& buffers);
+  void append_to_file(std::vector<std::string>& buffers);
+  size_t rotation_cut(const std::string& buffer, size_t start, size_t& lines) const;
+  double encoded_ratio() const;
+  void rotate();
+  void finish_encoding();
+  void route_graphs(std::string& buffer);
+  struct GraphSink;
+  std::shared_ptr<GraphSink> graph_sink(const std::string& graph);
+  void close_graph_sink(const std::string& graph);
+  void write_all(std::vector<std::string>& buffers);
+  void write_vectors(std::vector<std::string>& buffers);
+  void write_direct(const std::vector<std::string>& buffers);
+  void write_fully(const char* data, size_t size);
+  void preallocate(size_t incoming);
+  void drop_written_pages(bool final);
+  void finish_file();
+  void compress_and_write(const std::vector<std::string>& buffers, bool flush);
+  void run_parallel(size_t tasks, const std::function<void(size_t)>& task);
+  std::string compress_block(const std::string& block) const;
+
+  int fd_ = -1;
+  std::string base_path_;  // path the writer was opened with
+  std::string path_;       // current file, differs from base_path_ with rotation
+  size_t memory_cap_;
+  OutputSettings settings_;
+  std::string block_;  // start of the next compressed block, only used by the writer thread
+  std::unique_ptr<HdtEncoder> encoder_;  // binary format only
+  std::unique_ptr<TurtleSerializer> turtle_;  // Turtle only
+  std::unique_ptr<ExternalSorter> sorter_;     // sorted output only
+  // Sorted and rotated output is converted to Turtle and counted by the writer thread
+  bool deferred_ = false;
+  bool rotating_ = false;
+  bool header_pending_ = false;  // Turtle prefixes not yet written to the current file
+
+  // File state, only used by the writer thread until it is joined
+  bool direct_ = false;
+  bool drop_cache_ = false;
+  std::unique_ptr<char, FreeDeleter> direct_block_;  // aligned staging block of O_DIRECT writes
+  size_t staged_ = 0;
+  size_t file_start_ = 0;  // size of the file when it was opened
+  size_t reserved_ = 0;    // end of the preallocated space
+  size_t flushed_ = 0;     // end of the range written back, pages before dropped_ are dropped
+  size_t dropped_ = 0;
+  double write_seconds_ = 0;
+  std::atomic<size_t> expected_bytes_{0};
+  size_t file_index_ = 0;    // of the rotated file
+  size_t file_lines_ = 0;    // triples of the current rotated file
+  size_t file_content_ = 0;  // bytes of the triples of the current rotated file
+  size_t content_in_ = 0;      // N-Triples bytes handed to the encoding of all rotated files
+  size_t closed_content_ = 0;  // N-Triples bytes of the closed rotated files
+  size_t closed_bytes_ = 0;    // bytes written to the closed rotated files
+  std::vector<OutputFileStats> closed_files_;
+
+  // Graph routing. The pool of sinks is guarded by graph_mutex_, the plans hand their quads to
+  // a sink under its own mutex, which a closing sink takes to wait for the writes in flight.
+  struct GraphSink {
+    std::mutex mutex;
+    std::unique_ptr<OutputWriter> writer;  // null once the sink is closed
+    size_t last_use = 0;
+  };
+  std::mutex graph_mutex_;
+  std::unordered_map<std::string, std::shared_ptr<GraphSink>> graph_sinks_;
+  std::unordered_map<std::string, OutputFileStats> graph_files_;  // written by the closed sinks
+  size_t graph_uses_ = 0;
+
+  // Parallel work of the writer thread, its tasks are run by the writer thread, the plans
+  // blocked on back-pressure and the helper pool
+  struct SharedWork {
+    const std::function<void(size_t)>* task;
+    size_t tasks;
+    size_t next = 0;  // next task to start
+    size_t finished = 0;
+    size_t workers = 0;  // threads running tasks
+  };
+  void work_on(SharedWork& work, std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable space_available_;
+  std::condition_variable work_finished_;
+  SharedWork* shared_work_ = nullptr;
+  std::vector<std::string> pending_;
+  std::vector<std::string> free_buffers_;
+  size_t pending_bytes_ = 0;
+  size_t bytes_written_ = 0;
+  size_t lines_written_ = 0;
+  bool stop_ = false;
+  std::thread thread_;
+};
+
+// Output streamed to stdout ("-"), a named pipe or a Unix domain socket ("unix:/path" or the
+// path of a listening socket) instead of written to a file. Streams are not truncated.
+bool is_stream_output(const std::string& path);
+
+// Writer of an output file, opened on first use and shared by all plans of the execution.
+OutputWriter& output_writer(const std::filesystem::path& path);
+
+// Expected size of an output file in N-Triples. Opens its writer if the settings preallocate
+// space, compressed and converted output is not estimated.
+void expect_output_bytes(const std::filesystem::path& path, size_t bytes);
+
+// Write the pending buffers and close all writers, called at the end of an execution.
+// Returns what was written to each file.
+std::vector<OutputFileStats> close_output_writers();
+
+extern "C" {
+// Bytes and write bandwidth of the files of the last execution, a line per file
+// as key===value|||key===value
+const char* output_write_stats();
+}
@@ -0,0 +1,254 @@
+#include "resource_manager.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <set>
+#include <thread>
+
+#include "utils.h"
+
+// Parse a non-negative integer option, exits on invalid input
+static long parse_number(const std::string& key, const std::string& value) {
+  try {
+    size_t end = 0;
+    long number = std::stol(value, &end);
+    if (end == value.size() && number >= 0) {
+      return number;
+    }
+  } catch (const std::exception&) {
+  }
+  std::cout << "Error: Invalid value for " << key << ". Got: " << value << std::endl;
+  std::exit(1);
+}
+
+// Parse a CPU list like "0-3,8,10-11"
+static std::set<int> parse_cpu_list(const std::string& key, const std::string& cpu_list) {
+  std::set<int> cpus;
+  for (const auto& range : split_by_substring(cpu_list, ",")) {
+    if (range.empty()) {
+      continue;
+    }
+    std::vector<std::string> bounds = split_by_substring(range, "-");
+    if (bounds.size() > 2) {
+      std::cout << "Error: Invalid CPU list for " << key << ". Got: " << cpu_list << std::endl;
+      std::exit(1);
+    }
+    long first = parse_number(key, bounds[0]);
+    long last = bounds.size() == 2 ? parse_number(key, bounds[1]) : first;
+    for (long cpu = first; cpu <= last && cpu < CPU_SETSIZE; ++cpu) {
+      cpus.insert(static_cast<int>(cpu));
+    }
+  }
+  return cpus;
+}
+
+// CPUs of a NUMA node, as listed by the kernel
+static std::set<int> numa_node_cpus(int numa_node) {
+  std::string path = "/sys/devices/system/node/node" + std::to_string(numa_node) + "/cpulist";
+  std::ifstream file(path);
+  std::string cpu_list;
+  if (!file.is_open() || !std::getline(file, cpu_list)) {
+    std::cout << "Error: NUMA node " << numa_node << " not found." << std::endl;
+    std::exit(1);
+  }
+  return parse_cpu_list("numa_node", cpu_list);
+}
+
+bool parse_resource_option(const std::string& key, const std::string& value, ResourceSettings& settings) {
+  if (key == "threads") {
+    settings.max_threads = value.empty() ? 0 : parse_number(key, value);
+  } else if (key == "cpu_affinity") {
+    settings.cpu_affinity = value;
+  } else if (key == "numa_node") {
+    settings.numa_node = value.empty() ? -1 : static_cast<int>(parse_number(key, value));
+  } else {
+    return false;
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+ResourceManager& ResourceManager::instance() {
+  static ResourceManager manager;
+  return manager;
+}
+
+ResourceManager::ResourceManager() { configure(ResourceSettings{}); }
+
+void ResourceManager::configure(const ResourceSettings& settings) {
+  // CPUs the process may run on, e.g. restricted by taskset or a cgroup
+  std::set<int> allowed;
+  cpu_set_t process_cpus;
+  CPU_ZERO(&process_cpus);
+  if (sched_getaffinity(0, sizeof(process_cpus), &process_cpus) == 0) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+      if (CPU_ISSET(cpu, &process_cpus)) {
+        allowed.insert(cpu);
+      }
+    }
+  }
+
+  bool pinned = false;
+  auto restrict_to = [&allowed, &pinned](const std::set<int>& cpus) {
+    std::set<int> intersection;
+    std::set_intersection(allowed.begin(), allowed.end(), cpus.begin(), cpus.end(),
+                          std::inserter(intersection, intersection.begin()));
+    allowed = std::move(intersection);
+    pinned = true;
+  };
+  if (!settings.cpu_affinity.empty()) {
+    restrict_to(parse_cpu_list("cpu_affinity", settings.cpu_affinity));
+  }
+  if (settings.numa_node >= 0) {
+    restrict_to(numa_node_cpus(settings.numa_node));
+  }
+  if (pinned && allowed.empty()) {
+    std::cout << "Error: No usable CPU left after applying CPU affinity and NUMA node." << std::endl;
+    std::exit(1);
+  }
+
+  size_t available = allowed.size();
+  if (available == 0) {
+    available = std::max<size_t>(1, std::thread::hardware_concurrency());
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  budget_ = settings.max_threads > 0 ? std::min(settings.max_threads, available) : available;
+  pinned_cpus_.clear();
+  if (pinned) {
+    pinned_cpus_.assign(allowed.begin(), allowed.end());
+  }
+}
+
+size_t ResourceManager::budget() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return budget_;
+}
+
+size_t ResourceManager::acquire(size_t requested) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t available = budget_ > leased_ ? budget_ - leased_ : 0;
+  size_t granted = std::max<size_t>(1, std::min(requested, available));
+  leased_ += granted;
+  return granted;
+}
+
+size_t ResourceManager::acquire_spare(size_t requested) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  size_t granted = std::min(requested, budget_ > leased_ ? budget_ - leased_ : 0);
+  leased_ += granted;
+  return granted;
+}
+
+void ResourceManager::release(size_t granted) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  leased_ -= std::min(granted, leased_);
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+AffinityScope::AffinityScope() {
+  const std::vector<int>& cpus = ResourceManager::instance().pinned_cpus();
+  if (cpus.empty() || sched_getaffinity(0, sizeof(previous_), &previous_) != 0) {
+    return;
+  }
+
+  cpu_set_t pinned;
+  CPU_ZERO(&pinned);
+  for (int cpu : cpus) {
+    CPU_SET(cpu, &pinned);
+  }
+  active_ = sched_setaffinity(0, sizeof(pinned), &pinned) == 0;
+}
+
+AffinityScope::~AffinityScope() {
+  if (active_) {
+    sched_setaffinity(0, sizeof(previous_), &previous_);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+HelperPool& HelperPool::instance() {
+  static HelperPool pool;
+  return pool;
+}
+
+HelperPool::~HelperPool() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+// Job with a task left to start and fewer helpers than leased for it
+HelperPool::Job* HelperPool::open_job() {
+  for (Job* job : jobs_) {
+    if (job->next < job->tasks && job->joined < job->helpers) {
+      return job;
+    }
+  }
+  return nullptr;
+}
+
+void HelperPool::run_tasks(Job& job, std::unique_lock<std::mutex>& lock) {
+  while (job.next < job.tasks) {
+    size_t index = job.next++;
+    lock.unlock();
+    (*job.task)(index);
+    lock.lock();
+    ++job.finished;
+  }
+}
+
+void HelperPool::run(size_t tasks, const std::function<void(size_t)>& task) {
+  size_t helpers = tasks > 1 ? ResourceManager::instance().acquire_spare(tasks - 1) : 0;
+  if (helpers == 0) {
+    for (size_t i = 0; i < tasks; ++i) {
+      task(i);
+    }
+    return;
+  }
+
+  Job job{&task, tasks, helpers};
+  std::unique_lock<std::mutex> lock(mutex_);
+  // The pool grows to the most helpers leased at once, at most the budget
+  leased_helpers_ += helpers;
+  if (threads_.size() < leased_helpers_) {
+    AffinityScope affinity;
+    while (threads_.size() < leased_helpers_) {
+      threads_.emplace_back(&HelperPool::helper_loop, this);
+    }
+  }
+  jobs_.push_back(&job);
+  work_available_.notify_all();
+
+  run_tasks(job, lock);
+  job_finished_.wait(lock, [&job] { return job.finished == job.tasks && job.joined == 0; });
+  jobs_.erase(std::find(jobs_.begin(), jobs_.end(), &job));
+  leased_helpers_ -= helpers;
+  lock.unlock();
+  ResourceManager::instance().release(helpers);
+}
+
+void HelperPool::helper_loop() {
+  std::unique_lock<std::mutex> lock(mutex_);
+  for (;;) {
+    Job* job = nullptr;
+    work_available_.wait(lock, [this, &job] { return stop_ || (job = open_job()) != nullptr; });
+    if (stop_) {
+      return;
+    }
+    ++job->joined;
+    run_tasks(*job, lock);
+    --job->joined;
+    job_finished_.notify_all();
+  }
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <sched.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Settings of the CPU budget, given as executor options
+struct ResourceSettings {
+  size_t max_threads = 0;    // 0 = one thread per allowed CPU
+  std::string cpu_affinity;  // CPU list like "0-3,8", empty = no restriction
+  int numa_node = -1;        // < 0 = no restriction
+};
+
+// Returns true if key is a resource option and stores its value in settings.
+bool parse_resource_option(const std::string& key, const std::string& value, ResourceSettings& settings);
+
+// Process-wide CPU budget. Every parallel stage leases its worker threads from the budget,
+// so stages running at the same time never start more workers than the budget allows.
+// Lives in libexecutorruntime.so, so both executor libraries share one budget and helper pool.
+class ResourceManager {
+ public:
+  static ResourceManager& instance();
+
+  // Allowed CPUs are the CPUs of the process, restricted by the affinity list and the NUMA node.
+  void configure(const ResourceSettings& settings);
+
+  size_t budget() const;
+
+  // Reserve up to requested workers. At least one is granted, so a stage always makes progress.
+  size_t acquire(size_t requested);
+  // Reserve up to requested helpers from the part of the budget not leased yet, may grant none.
+  size_t acquire_spare(size_t requested);
+  void release(size_t granted);
+
+  // CPUs threads are bound to, empty if no affinity or NUMA node was requested.
+  const std::vector<int>& pinned_cpus() const { return pinned_cpus_; }
+
+ private:
+  ResourceManager();
+
+  mutable std::mutex mutex_;
+  size_t budget_ = 1;
+  size_t leased_ = 0;
+  std::vector<int> pinned_cpus_;
+};
+
+// Workers leased from the budget for the lifetime of the lease.
+class ThreadLease {
+ public:
+  explicit ThreadLease(size_t requested) : count_(ResourceManager::instance().acquire(requested)) {}
+  ~ThreadLease() { ResourceManager::instance().release(count_); }
+
+  ThreadLease(const ThreadLease&) = delete;
+  ThreadLease& operator=(const ThreadLease&) = delete;
+
+  size_t count() const { return count_; }
+
+ private:
+  size_t count_;
+};
+
+// Binds the calling thread to the pinned CPUs, threads started in the scope inherit the binding.
+// The previous binding is restored when the scope ends.
+class AffinityScope {
+ public:
+  AffinityScope();
+  ~AffinityScope();
+
+  AffinityScope(const AffinityScope&) = delete;
+  AffinityScope& operator=(const AffinityScope&) = delete;
+
+ private:
+  cpu_set_t previous_;
+  bool active_ = false;
+};
+
+// Persistent helper threads for short parallel jobs of threads outside the scheduler, like
+// compressing the blocks of an output batch or sorting a run. A job runs on the calling thread
+// and on the helpers leased for it from the spare budget. While the workers of an execution
+// hold the whole budget, the calling thread runs the job alone.
+class HelperPool {
+ public:
+  static HelperPool& instance();
+  ~HelperPool();
+
+  // Runs task(0) ... task(tasks - 1) and returns when all have finished.
+  void run(size_t tasks, const std::function<void(size_t)>& task);
+
+ private:
+  struct Job {
+    const std::function<void(size_t)>* task;
+    size_t tasks;
+    size_t helpers;      // leased for the job
+    size_t joined = 0;   // helpers working on the job
+    size_t next = 0;     // next task to start
+    size_t finished = 0;
+  };
+
+  HelperPool() = default;
+  void helper_loop();
+  Job* open_job();
+  void run_tasks(Job& job, std::unique_lock<std::mutex>& lock);
+
+  std::mutex mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable job_finished_;
+  std::vector<Job*> jobs_;
+  std::vector<std::thread> threads_;
+  size_t leased_helpers_ = 0;
+  bool stop_ = false;
+};
@@ -0,0 +1,131 @@
+#include "result_store.h"
+
+#include <array>
+
+#include "ntriples.h"
+
+void ResultStore::reset(bool dictionary) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  dictionary_ = dictionary;
+  std::vector<Segment>().swap(segments_);
+  term_ids_.clear();
+  terms_.clear();
+  std::string().swap(decoded_);
+}
+
+void ResultStore::add(std::string&& buffer) {
+  if (buffer.empty()) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  Segment segment;
+  if (dictionary_) {
+    encode(buffer, segment.encoded);
+    segment.encoded.shrink_to_fit();
+    buffer.clear();
+  } else {
+    segment.text = std::move(buffer);
+    buffer.clear();
+  }
+  segments_.push_back(std::move(segment));
+}
+
+size_t ResultStore::segments() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return segments_.size();
+}
+
+std::string_view ResultStore::segment(size_t index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index >= segments_.size()) {
+    return {};
+  }
+  if (!dictionary_) {
+    return segments_[index].text;
+  }
+  decoded_.clear();
+  decode(segments_[index].encoded, decoded_);
+  return decoded_;
+}
+
+void ResultStore::release(size_t index) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  if (index < segments_.size()) {
+    std::vector<uint32_t>().swap(segments_[index].encoded);
+    std::string().swap(segments_[index].text);
+  }
+}
+
+uint32_t ResultStore::term_id(std::string_view term) {
+  auto it = term_ids_.find(term);
+  if (it != term_ids_.end()) {
+    return it->second;
+  }
+  uint32_t id = static_cast<uint32_t>(terms_.size());
+  terms_.emplace_back(term);
+  term_ids_.emplace(terms_.back(), id);
+  return id;
+}
+
+// A line is stored as its number of terms and their ids. A line that is no triple keeps
+// its text as a single term.
+void ResultStore::encode(const std::string& buffer, std::vector<uint32_t>& encoded) {
+  std::string_view data(buffer);
+  std::array<std::string_view, 4> terms;
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    if (line_end == std::string_view::npos) {
+      line_end = data.size();
+    }
+    std::string_view line = data.substr(line_start, line_end - line_start);
+    line_start = line_end + 1;
+    if (line.empty()) {
+      continue;
+    }
+
+    size_t count = split_ntriples_line(line, terms);
+    if (count == 0) {
+      encoded.push_back(1);
+      encoded.push_back(term_id(line));
+      continue;
+    }
+    encoded.push_back(static_cast<uint32_t>(count));
+    for (size_t i = 0; i < count; ++i) {
+      encoded.push_back(term_id(terms[i]));
+    }
+  }
+}
+
+void ResultStore::decode(const std::vector<uint32_t>& encoded, std::string& text) const {
+  for (size_t i = 0; i < encoded.size();) {
+    uint32_t count = encoded[i++];
+    if (count == 1) {
+      text += terms_[encoded[i++]];
+      text += '\n';
+      continue;
+    }
+    for (uint32_t t = 0; t < count; ++t) {
+      text += terms_[encoded[i++]];
+      text += ' ';
+    }
+    text += ".\n";
+  }
+}
+
+ResultStore& result_store() {
+  static ResultStore store;
+  return store;
+}
+
+extern "C" {
+size_t result_segment_count() { return result_store().segments(); }
+
+const char* result_segment(size_t index, size_t* size) {
+  std::string_view segment = result_store().segment(index);
+  *size = segment.size();
+  return segment.data();
+}
+
+void release_result_segment(size_t index) { result_store().release(index); }
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Triples of an execution kept in memory (keep_in_memory), read by the caller segment by
+// segment instead of as one result string. Every partition buffer is moved in as a segment.
+// With the term dictionary a segment stores the ids of its terms, every distinct term is
+// kept once. Segments are decoded to N-Triples when they are read.
+class ResultStore {
+ public:
+  // Drops the segments of the last execution.
+  void reset(bool dictionary);
+
+  // Adds the complete N-Triples lines of a buffer as a segment, buffer is left empty.
+  void add(std::string&& buffer);
+
+  size_t segments() const;
+
+  // N-Triples of a segment, valid until the next call or until the segment is released.
+  std::string_view segment(size_t index);
+
+  // Frees a segment the caller has read.
+  void release(size_t index);
+
+ private:
+  struct Segment {
+    std::string text;                // without dictionary
+    std::vector<uint32_t> encoded;  // term count of a line followed by the term ids
+  };
+
+  uint32_t term_id(std::string_view term);
+  void encode(const std::string& buffer, std::vector<uint32_t>& encoded);
+  void decode(const std::vector<uint32_t>& encoded, std::string& text) const;
+
+  mutable std::mutex mutex_;
+  bool dictionary_ = false;
+  std::vector<Segment> segments_;
+  std::deque<std::string> terms_;  // never moved, the map views into it
+  std::unordered_map<std::string_view, uint32_t> term_ids_;
+  std::string decoded_;
+};
+
+// Store of the current execution.
+ResultStore& result_store();
+
+extern "C" {
+size_t result_segment_count();
+// N-Triples of a segment and its size in bytes, not null terminated
+const char* result_segment(size_t index, size_t* size);
+void release_result_segment(size_t index);
+}
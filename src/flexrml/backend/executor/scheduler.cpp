@@ -0,0 +1,188 @@
+#include "scheduler.h"
+
+// Scheduler and worker id of the calling thread
+static thread_local Scheduler* current_scheduler = nullptr;
+static thread_local size_t current_worker_id = 0;
+
+Scheduler::Scheduler(size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    queues_.push_back(std::make_unique<WorkerQueue>());
+  }
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers_.emplace_back([this, i] { worker_loop(i); });
+  }
+}
+
+Scheduler::~Scheduler() { shutdown(); }
+
+Scheduler* Scheduler::current() { return current_scheduler; }
+
+void Scheduler::spawn(std::function<void()> task) {
+  bool subtask = current_scheduler == this;
+  WorkerQueue& queue = subtask ? *queues_[current_worker_id] : shared_queue_;
+
+  outstanding_.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+  }
+  bool wake_parked = false;
+  {
+    // Increment under the sleep mutex, so a worker going to sleep cannot miss the task
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    queued_.fetch_add(1, std::memory_order_release);
+    if (subtask) {
+      queued_subtasks_.fetch_add(1, std::memory_order_release);
+      wake_parked = num_parked_ > 0;
+    }
+  }
+  work_available_.notify_one();
+  if (wake_parked) {
+    parked_.notify_all();
+  }
+}
+
+bool Scheduler::pop_local(size_t worker_id, std::function<void()>& task) {
+  WorkerQueue& queue = *queues_[worker_id];
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.tasks.empty()) {
+    return false;
+  }
+  task = std::move(queue.tasks.back());
+  queue.tasks.pop_back();
+  queued_subtasks_.fetch_sub(1, std::memory_order_relaxed);
+  return true;
+}
+
+bool Scheduler::pop_shared(std::function<void()>& task) {
+  std::lock_guard<std::mutex> lock(shared_queue_.mutex);
+  if (shared_queue_.tasks.empty()) {
+    return false;
+  }
+  task = std::move(shared_queue_.tasks.front());
+  shared_queue_.tasks.pop_front();
+  return true;
+}
+
+bool Scheduler::steal(size_t worker_id, std::function<void()>& task) {
+  for (size_t offset = 1; offset <= queues_.size(); ++offset) {
+    WorkerQueue& queue = *queues_[(worker_id + offset) % queues_.size()];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (!queue.tasks.empty()) {
+      // Oldest tasks are the largest, take them from the front
+      task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+      queued_subtasks_.fetch_sub(1, std::memory_order_relaxed);
+      return true;
+    }
+  }
+  return false;
+}
+
+void Scheduler::run_task(std::function<void()>& task) {
+  queued_.fetch_sub(1, std::memory_order_relaxed);
+  task();
+  task = nullptr;
+
+  if (outstanding_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    idle_.notify_all();
+  }
+}
+
+bool Scheduler::run_pending_subtask() {
+  std::function<void()> task;
+  size_t worker_id = current_scheduler == this ? current_worker_id : 0;
+  if ((current_scheduler == this && pop_local(worker_id, task)) || steal(worker_id, task)) {
+    run_task(task);
+    return true;
+  }
+  return false;
+}
+
+void Scheduler::park(const std::atomic<size_t>& pending) {
+  std::unique_lock<std::mutex> lock(sleep_mutex_);
+  ++num_parked_;
+  parked_.wait(lock, [this, &pending] {
+    return pending.load(std::memory_order_acquire) == 0 || queued_subtasks_.load(std::memory_order_acquire) > 0;
+  });
+  --num_parked_;
+}
+
+void Scheduler::notify_parked() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    if (num_parked_ == 0) {
+      return;
+    }
+  }
+  parked_.notify_all();
+}
+
+void Scheduler::worker_loop(size_t worker_id) {
+  current_scheduler = this;
+  current_worker_id = worker_id;
+
+  for (;;) {
+    std::function<void()> task;
+    // Own subtasks first, then new top level tasks, then subtasks of other workers
+    if (pop_local(worker_id, task) || pop_shared(task) || steal(worker_id, task)) {
+      run_task(task);
+      continue;
+    }
+
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    work_available_.wait(lock, [this] { return stop_ || queued_.load(std::memory_order_acquire) > 0; });
+    if (stop_ && queued_.load(std::memory_order_acquire) == 0) {
+      return;
+    }
+  }
+}
+
+void Scheduler::wait_idle() {
+  std::unique_lock<std::mutex> lock(sleep_mutex_);
+  idle_.wait(lock, [this] { return outstanding_.load(std::memory_order_acquire) == 0; });
+}
+
+void Scheduler::shutdown() {
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    if (stop_) {
+      return;
+    }
+    stop_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////////////
+
+void TaskGroup::run(std::function<void()> task) {
+  pending_.fetch_add(1, std::memory_order_relaxed);
+  scheduler_.spawn([this, task = std::move(task)] {
+    task();
+    // The group may be gone once pending_ is zero
+    Scheduler& scheduler = scheduler_;
+    if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+      scheduler.notify_parked();
+    }
+  });
+}
+
+void TaskGroup::wait() {
+  while (pending_.load(std::memory_order_acquire) > 0) {
+    // Help with the subtasks instead of blocking, they may be queued behind us. Top level tasks are
+    // left to idle workers, taking a whole partition here would hold up the task waiting for the group.
+    if (!scheduler_.run_pending_subtask()) {
+      scheduler_.park(pending_);
+    }
+  }
+}
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task scheduler. Every worker owns a deque: it pushes and pops its own
+// tasks at the back and steals from the front of the other deques when it runs dry.
+// Tasks spawned by a running task stay on the deque of its worker, so subtasks of a
+// large task are picked up by idle workers instead of waiting behind it.
+// Tasks spawned from outside go to a shared queue that is served in spawn order,
+// so spawning the largest tasks first gives longest-processing-time-first scheduling.
+class Scheduler {
+ public:
+  explicit Scheduler(size_t num_threads);
+  ~Scheduler();
+
+  Scheduler(const Scheduler&) = delete;
+  Scheduler& operator=(const Scheduler&) = delete;
+
+  // Queue a task. From a worker the task goes to its own deque, otherwise to the shared queue.
+  void spawn(std::function<void()> task);
+
+  // Run one queued subtask on the calling thread, its own or one stolen from another worker.
+  // Top level tasks are left to the idle workers. Returns false if no subtask was found.
+  bool run_pending_subtask();
+
+  // Block until pending is zero or a subtask is queued.
+  void park(const std::atomic<size_t>& pending);
+
+  // Wake the parked threads to check their pending count.
+  void notify_parked();
+
+  // Block until all spawned tasks have finished.
+  void wait_idle();
+
+  void shutdown();
+
+  size_t num_workers() const { return workers_.size(); }
+
+  // Scheduler of the calling worker thread, nullptr outside of a scheduler.
+  static Scheduler* current();
+
+ private:
+  struct WorkerQueue {
+    std::mutex mutex;
+    std::deque<std::function<void()>> tasks;
+  };
+
+  void worker_loop(size_t worker_id);
+  bool pop_local(size_t worker_id, std::function<void()>& task);
+  bool pop_shared(std::function<void()>& task);
+  bool steal(size_t worker_id, std::function<void()>& task);
+  void run_task(std::function<void()>& task);
+
+  std::vector<std::unique_ptr<WorkerQueue>> queues_;
+  WorkerQueue shared_queue_;
+  std::vector<std::thread> workers_;
+
+  std::atomic<size_t> queued_{0};           // tasks waiting in a deque
+  std::atomic<size_t> queued_subtasks_{0};  // tasks waiting in the deque of a worker
+  std::atomic<size_t> outstanding_{0};      // tasks spawned and not finished
+
+  std::mutex sleep_mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable idle_;
+  std::condition_variable parked_;  // threads waiting for a task group
+  size_t num_parked_ = 0;
+  bool stop_ = false;
+};
+
+// Subtasks created inside a task, e.g. chunks of a scan or partitions of a join.
+// wait() runs queued subtasks while the group is pending, so a worker never blocks on its own
+// subtasks. With no subtask left to run it parks until the group finishes or a subtask is queued.
+class TaskGroup {
+ public:
+  explicit TaskGroup(Scheduler& scheduler) : scheduler_(scheduler) {}
+  ~TaskGroup() { wait(); }
+
+  void run(std::function<void()> task);
+  void wait();
+
+ private:
+  Scheduler& scheduler_;
+  std::atomic<size_t> pending_{0};
+};
@@ -0,0 +1,209 @@
+#include "sharded_output.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <unordered_map>
+
+#include "utils.h"
+
+namespace fs = std::filesystem;
+
+std::string shard_path(const std::string& output_file, size_t shard) {
+  char number[16];
+  std::snprintf(number, sizeof(number), "%05zu", shard);
+  return insert_before_extensions(output_file, '.', std::string("part-") + number);
+}
+
+// Replace the output path of a plan, the line after the format line
+static std::string redirect_plan(const std::string& plan, const std::string& output_file) {
+  std::vector<std::string> lines = split_by_substring(plan, "\n");
+  if (lines.size() == 5) {
+    lines[2] = output_file;
+  } else if (lines.size() == 7) {
+    lines[4] = output_file;
+  }
+
+  std::string redirected = lines[0];
+  for (size_t i = 1; i < lines.size(); ++i) {
+    redirected += "\n" + lines[i];
+  }
+  return redirected;
+}
+
+std::vector<std::string> assign_output_shards(std::vector<std::vector<std::string>>& partitions, const std::string& output_file) {
+  std::vector<std::string> shards;
+  shards.reserve(partitions.size());
+  for (size_t p = 0; p < partitions.size(); ++p) {
+    shards.push_back(shard_path(output_file, p));
+    for (auto& plan : partitions[p]) {
+      plan = redirect_plan(plan, shards.back());
+    }
+
+    // Writers append, start from an empty shard
+    std::ofstream shard(shards.back(), std::ios::out | std::ios::trunc);
+    if (!shard) {
+      std::cout << "Error: Unable to create output shard " << shards.back() << std::endl;
+      std::exit(1);
+    }
+  }
+  return shards;
+}
+
+void write_shard_manifest(const std::string& output_file, const std::vector<std::string>& shards,
+                          const std::vector<OutputFileStats>& written) {
+  std::unordered_map<std::string, const OutputFileStats*> stats_of_file;
+  for (const auto& stats : written) {
+    stats_of_file[stats.path] = &stats;
+  }
+
+  size_t total_triples = 0;
+  std::string entries;
+  for (const auto& shard : shards) {
+    size_t triples = 0;
+    size_t bytes = 0;
+    if (auto it = stats_of_file.find(shard); it != stats_of_file.end()) {
+      triples = it->second->lines;
+      bytes = it->second->bytes;
+    }
+    total_triples += triples;
+    if (!entries.empty()) {
+      entries += ",\n";
+    }
+    entries += "    {\"file\": \"" + fs::path(shard).filename().string() + "\", \"triples\": " + std::to_string(triples) +
+               ", \"bytes\": " + std::to_string(bytes) + "}";
+  }
+
+  std::string manifest_path = replace_extensions(output_file, ".manifest.json");
+  std::ofstream manifest(manifest_path, std::ios::out | std::ios::trunc);
+  if (!manifest) {
+    std::cout << "Error: Unable to write manifest " << manifest_path << std::endl;
+    std::exit(1);
+  }
+  manifest << "{\n  \"triples\": " << total_triples << ",\n  \"shards\": [\n" << entries << "\n  ]\n}\n";
+}
+
+// Graph terms are IRIs or blank nodes, IRIs may hold backslash escapes
+static std::string json_string(const std::string& text) {
+  std::string escaped = "\"";
+  for (char c : text) {
+    if (c == '"' || c == '\\') {
+      escaped += '\\';
+    }
+    escaped += c;
+  }
+  return escaped + "\"";
+}
+
+void write_graph_manifest(const std::string& output_file, const std::vector<OutputFileStats>& written) {
+  std::vector<const OutputFileStats*> graph_files;
+  for (const auto& file : written) {
+    if (!file.graph.empty()) {
+      graph_files.push_back(&file);
+    }
+  }
+  std::sort(graph_files.begin(), graph_files.end(), [](const OutputFileStats* a, const OutputFileStats* b) {
+    return a->graph != b->graph ? a->graph < b->graph : a->path < b->path;
+  });
+
+  size_t total_triples = 0;
+  std::string entries;
+  for (const auto* file : graph_files) {
+    total_triples += file->lines;
+    if (!entries.empty()) {
+      entries += ",\n";
+    }
+    entries += "    {\"graph\": " + json_string(file->graph) + ", \"file\": " +
+               json_string(fs::path(file->path).filename().string()) + ", \"triples\": " + std::to_string(file->lines) +
+               ", \"bytes\": " + std::to_string(file->bytes) + "}";
+  }
+
+  std::string manifest_path = replace_extensions(output_file, ".graphs.json");
+  std::ofstream manifest(manifest_path, std::ios::out | std::ios::trunc);
+  if (!manifest) {
+    std::cout << "Error: Unable to write manifest " << manifest_path << std::endl;
+    std::exit(1);
+  }
+  manifest << "{\n  \"triples\": " << total_triples << ",\n  \"graphs\": [\n" << entries << "\n  ]\n}\n";
+}
+
+// Copy through user space if the kernel cannot copy between the two files
+static bool copy_through_buffer(int in, int out) {
+  char buffer[1 << 16];
+  for (;;) {
+    ssize_t read_bytes = ::read(in, buffer, sizeof(buffer));
+    if (read_bytes == 0) {
+      return true;
+    }
+    if (read_bytes < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return false;
+    }
+    for (ssize_t offset = 0; offset < read_bytes;) {
+      ssize_t written = ::write(out, buffer + offset, read_bytes - offset);
+      if (written < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        return false;
+      }
+      offset += written;
+    }
+  }
+}
+
+static bool append_file(int in, int out) {
+  struct stat info;
+  if (::fstat(in, &info) != 0) {
+    return false;
+  }
+
+  size_t remaining = info.st_size;
+  while (remaining > 0) {
+    ssize_t copied = ::copy_file_range(in, nullptr, out, nullptr, remaining, 0);
+    if (copied < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP) {
+        return copy_through_buffer(in, out);
+      }
+      return false;
+    }
+    if (copied == 0) {
+      break;  // file shrank while copying
+    }
+    remaining -= copied;
+  }
+  return true;
+}
+
+void concatenate_shards(const std::string& output_file, const std::vector<std::string>& shards) {
+  int out = ::open(output_file.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (out < 0) {
+    std::cout << "Error: Unable to open file for writing. Got: " << output_file << std::endl;
+    std::exit(1);
+  }
+
+  for (const auto& shard : shards) {
+    int in = ::open(shard.c_str(), O_RDONLY | O_CLOEXEC);
+    if (in < 0 || !append_file(in, out)) {
+      std::cout << "Error: Concatenating " << shard << " failed: " << std::strerror(errno) << std::endl;
+      std::exit(1);
+    }
+    ::close(in);
+    std::error_code error;
+    fs::remove(shard, error);
+  }
+  ::close(out);
+}
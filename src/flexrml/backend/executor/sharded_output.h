@@ -0,0 +1,27 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "output_writer.h"
+
+// Path of a shard of the output file, out.nt.gz -> out.part-00017.nt.gz
+std::string shard_path(const std::string& output_file, size_t shard);
+
+// Give every partition its own shard of the output file. The output path of each plan
+// is replaced by the shard of its partition and the shards are created empty.
+// Returns the shard of every partition.
+std::vector<std::string> assign_output_shards(std::vector<std::vector<std::string>>& partitions, const std::string& output_file);
+
+// Write the manifest of the shards next to the output file (out.nt.gz -> out.manifest.json),
+// listing the triples and bytes of every shard.
+void write_shard_manifest(const std::string& output_file, const std::vector<std::string>& shards,
+                          const std::vector<OutputFileStats>& written);
+
+// Write the manifest of the routed graph files next to the output file (out.graphs.json),
+// listing the graph, triples and bytes of every file.
+void write_graph_manifest(const std::string& output_file, const std::vector<OutputFileStats>& written);
+
+// Concatenate the shards into the output file and remove them. The data is copied
+// inside the kernel with copy_file_range where the file system supports it.
+void concatenate_shards(const std::string& output_file, const std::vector<std::string>& shards);
@@ -1,7 +1,9 @@
 #include "simple_executor.h"
 
 #include <algorithm>
+#include <atomic>
 #include <condition_variable>
+#include <cstdint>
 #include <filesystem>
 #include <format>
 #include <fstream>
@@ -10,6 +12,7 @@
 #include <sstream>
 #include <set>
 #include <map>
+#include <memory>
 #include <mutex>
 #include <queue>
 #include <string>
@@ -19,6 +22,8 @@
 #include <utility>
 
 #include "definitions.h"
+#include "output_writer.h"
+#include "scheduler.h"
 #include "utils.h"
 
 namespace fs = std::filesystem;
@@ -46,7 +51,7 @@ struct SetupData {
   std::string res;
   std::string buffered_res;
 
-  std::ofstream outputFile;
+  OutputWriter* output = nullptr;
 };
 
 SetupData initialize_setup(const fs::path& output_file_name) {
@@ -64,14 +69,7 @@ SetupData initialize_setup(const fs::path& output_file_name) {
   data.res.reserve(2048);
   data.buffered_res.reserve(204800);
 
-  // Open output file
-  fs::create_directories(output_file_name.parent_path());
-  data.outputFile.open(output_file_name, std::ios::app);
-
-  if (!data.outputFile) {
-    std::cerr << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
+  data.output = &output_writer(output_file_name);
 
   return data;
 }
@@ -238,27 +236,26 @@ int execute_simple_with_graph(const std::string& input_file_name,
     if (setup_data.write_cnt == setup_data.buffer_limit) {
       setup_data.write_cnt = 0;
       ////// SERIALIZE //////
-      setup_data.outputFile << setup_data.buffered_res;
-      setup_data.buffered_res = "";
+      setup_data.output->write(setup_data.buffered_res);
     }
   }
   ////// SERIALIZE //////
-  setup_data.outputFile << setup_data.buffered_res;
+  setup_data.output->write(setup_data.buffered_res);
 
   return setup_data.triple_counter;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::unordered_set<std::string> execute_simple_with_graph_dependent(const std::string& input_file_name,
-                                                                    const fs::path& output_file_name,
-                                                                    const std::string& base_uri,
-                                                                    const std::vector<std::string>& projected_attributes,
-                                                                    const std::vector<std::string>& s_content,
-                                                                    const std::vector<std::string>& p_content,
-                                                                    const std::vector<std::string>& o_content,
-                                                                    const std::vector<std::string>& g_content,
-                                                                    std::unordered_set<std::string>& unique_triple,
-                                                                    const std::unordered_map<std::string, std::string>& data_map) {
+void execute_simple_with_graph_dependent(const std::string& input_file_name,
+                                         const fs::path& output_file_name,
+                                         const std::string& base_uri,
+                                         const std::vector<std::string>& projected_attributes,
+                                         const std::vector<std::string>& s_content,
+                                         const std::vector<std::string>& p_content,
+                                         const std::vector<std::string>& o_content,
+                                         const std::vector<std::string>& g_content,
+                                         TripleCollector& unique_triple,
+                                         const std::unordered_map<std::string, std::string>& data_map) {
   // Setup
   SetupData setup_data = initialize_setup_dependent(output_file_name);
 
@@ -354,8 +351,6 @@ std::unordered_set<std::string> execute_simple_with_graph_dependent(const std::s
     unique_triple.insert(setup_data.res);
     setup_data.triple_counter++;
   }
-
-  return unique_triple;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -459,12 +454,11 @@ int execute_simple(const std::string& input_file_name,
     if (setup_data.write_cnt == setup_data.buffer_limit) {
       setup_data.write_cnt = 0;
       ////// SERIALIZE //////
-      setup_data.outputFile << setup_data.buffered_res;
-      setup_data.buffered_res = "";
+      setup_data.output->write(setup_data.buffered_res);
     }
   }
   ////// SERIALIZE //////
-  setup_data.outputFile << setup_data.buffered_res;
+  setup_data.output->write(setup_data.buffered_res);
 
   return setup_data.triple_counter;
 }
@@ -472,15 +466,15 @@ int execute_simple(const std::string& input_file_name,
 
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
-std::unordered_set<std::string> execute_simple_dependent(const std::string& input_file_name,
-                                                         const fs::path& output_file_name,
-                                                         const std::string& base_uri,
-                                                         const std::vector<std::string>& projected_attributes,
-                                                         const std::vector<std::string>& s_content,
-                                                         const std::vector<std::string>& p_content,
-                                                         const std::vector<std::string>& o_content,
-                                                         std::unordered_set<std::string>& unique_triple,
-                                                        const std::unordered_map<std::string, std::string>& data_map) {
+void execute_simple_dependent(const std::string& input_file_name,
+                              const fs::path& output_file_name,
+                              const std::string& base_uri,
+                              const std::vector<std::string>& projected_attributes,
+                              const std::vector<std::string>& s_content,
+                              const std::vector<std::string>& p_content,
+                              const std::vector<std::string>& o_content,
+                              TripleCollector& unique_triple,
+                             const std::unordered_map<std::string, std::string>& data_map) {
   ///// Setup /////
   SetupData setup_data = initialize_setup_dependent(output_file_name);
 
@@ -568,8 +562,6 @@ std::unordered_set<std::string> execute_simple_dependent(const std::string& inpu
 
     unique_triple.insert(setup_data.res);
   }
-
-  return unique_triple;
 }
 
 //////////////////////////////////////////////////////////////////////////////////////////////////////////////////
@@ -640,6 +632,9 @@ size_t standalone_simple_mapping(const std::string& information, const std::unor
       } else if (info.s_content[1] == "preformatted" && info.p_content[1] == "preformatted" && info.o_content[1] == "preformatted") {
         handle_constant_preformatted(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name);
         info.generated_triple = 1;
+      } else if (Scheduler::current() != nullptr) {
+        // Inside the scheduler the scan is split into chunks
+        info.generated_triple = fused_simple_mapping({information}, data_map);
       } else {
         info.generated_triple = execute_simple(info.input_file_name, info.output_file_name, info.base_uri,
                                                info.projected_attributes, info.s_content, info.p_content, info.o_content, data_map);
@@ -652,6 +647,8 @@ size_t standalone_simple_mapping(const std::string& information, const std::unor
       } else if (info.s_content[1] == "preformatted" && info.p_content[1] == "preformatted" && info.o_content[1] == "preformatted" && info.g_content[1] == "preformatted") {
         handle_constant_preformatted(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name);
         info.generated_triple = 1;
+      } else if (Scheduler::current() != nullptr) {
+        info.generated_triple = fused_simple_mapping({information}, data_map);
       } else {
         // If not constant handle normal
         info.generated_triple = execute_simple_with_graph(info.input_file_name, info.output_file_name, info.base_uri,
@@ -671,7 +668,7 @@ size_t standalone_simple_mapping(const std::string& information, const std::unor
   return info.generated_triple;
 }
 
-std::unordered_set<std::string> dependent_simple_mapping(const std::string& information, std::unordered_set<std::string>& unique_triple, const std::unordered_map<std::string, std::string>& data_map) {
+void dependent_simple_mapping(const std::string& information, TripleCollector& unique_triple, const std::unordered_map<std::string, std::string>& data_map) {
   // Extract relevant parts
   ParsedContent info = parse_information(information);
 
@@ -685,27 +682,27 @@ std::unordered_set<std::string> dependent_simple_mapping(const std::string& info
       // Check if all entrries are constant
       if (info.s_content[1] == "constant" && info.p_content[1] == "constant" && info.o_content[1] == "constant") {
         std::vector<std::string> g_content;
-        unique_triple = handle_constant_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
+        handle_constant_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
         info.generated_triple = 1;
       } else if (info.s_content[1] == "preformatted" && info.p_content[1] == "preformatted" && info.o_content[1] == "preformatted") {
-        unique_triple = handle_constant_preformatted_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
+        handle_constant_preformatted_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
         info.generated_triple = 1;
       } else {
-        unique_triple = execute_simple_dependent(info.input_file_name, info.output_file_name, info.base_uri, info.projected_attributes,
-                                                 info.s_content, info.p_content, info.o_content, unique_triple, data_map);
+        execute_simple_dependent(info.input_file_name, info.output_file_name, info.base_uri, info.projected_attributes,
+                                 info.s_content, info.p_content, info.o_content, unique_triple, data_map);
       }
     } else {
       // Handle with graph
       if (info.s_content[1] == "constant" && info.p_content[1] == "constant" && info.o_content[1] == "constant" && info.g_content[1] == "constant") {
-        unique_triple = handle_constant_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
+        handle_constant_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
         info.generated_triple = 1;
       } else if (info.s_content[1] == "preformatted" && info.p_content[1] == "preformatted" && info.o_content[1] == "preformatted" && info.g_content[1] == "preformatted") {
-        unique_triple = handle_constant_preformatted_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
+        handle_constant_preformatted_dependent(info.s_content, info.p_content, info.o_content, info.g_content, info.output_file_name, unique_triple);
         info.generated_triple = 1;
       } else {
         // If not constant handle normal
-        unique_triple = execute_simple_with_graph_dependent(info.input_file_name, info.output_file_name, info.base_uri, info.projected_attributes,
-                                                            info.s_content, info.p_content, info.o_content, info.g_content, unique_triple, data_map);
+        execute_simple_with_graph_dependent(info.input_file_name, info.output_file_name, info.base_uri, info.projected_attributes,
+                                            info.s_content, info.p_content, info.o_content, info.g_content, unique_triple, data_map);
       }
     }
   } catch (const std::runtime_error& e) {
@@ -717,6 +714,364 @@ std::unordered_set<std::string> dependent_simple_mapping(const std::string& info
     std::cout << "Unknown exception caught!" << std::endl;
     std::exit(1);
   }
+}
+
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/// FUSED SCAN
+//////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Simple plans reading the same source share one pass over it. The source is read and
+// tokenized once per row, every plan keeps its own projection, duplicate elimination and formatting.
+// Plans with the same subject (or graph) form a star: the term is built once per row and
+// shared by all predicate-object maps of the star.
+
+// Returns true if all terms of the plan are constant, so the plan does not read its source
+static bool is_constant_plan(const ParsedContent& info) {
+  std::vector<const std::vector<std::string>*> contents = {&info.s_content, &info.p_content, &info.o_content};
+  if (info.generate_graph) {
+    contents.push_back(&info.g_content);
+  }
+  bool constant = true;
+  bool preformatted = true;
+  for (const auto* content : contents) {
+    constant = constant && (*content)[1] == "constant";
+    preformatted = preformatted && (*content)[1] == "preformatted";
+  }
+  return constant || preformatted;
+}
+
+std::string simple_plan_source(const std::string& information) {
+  if (split_by_substring(information, "\n").size() != 5) {
+    return "";
+  }
+  ParsedContent info = parse_information(information);
+  if (is_constant_plan(info)) {
+    return "";
+  }
+  return info.input_file_name;
+}
 
-  return unique_triple;
+// One plan consuming a fused scan
+struct FusedPlan {
+  ParsedContent info;
+  std::vector<int> projected_indices;
+  std::unique_ptr<ConcurrentHashSet> unique_hashes = std::make_unique<ConcurrentHashSet>();
+  TripleCollector* unique_triple = nullptr;  // nullptr = write to the output file
+  size_t subject_term = 0;
+  size_t graph_term = 0;  // only used if the plan generates a graph
+  std::vector<std::string> missing_po;  // attributes of predicate and object the plan does not project
+};
+
+// Subject or graph term shared by the plans of a star, built at most once per row
+struct SharedTerm {
+  SharedTerm(const std::vector<std::string>* content, const std::string* base_uri, std::vector<std::string> missing)
+      : content(content), base_uri(base_uri), missing(std::move(missing)) {}
+
+  const std::vector<std::string>* content;
+  const std::string* base_uri;
+  std::vector<std::string> missing;  // attributes of the term the plans do not project
+  size_t row_number = SIZE_MAX;  // row the value belongs to
+  std::string value;
+  bool failed = false;  // building the term failed for the row
+  std::string error;
+};
+
+// Attributes referenced by a term map that are not projected by the plan. The row map of a
+// fused scan holds the union of all projections, these attributes have to stay empty for the plan.
+static std::vector<std::string> missing_attributes(const std::vector<std::string>& content, const std::vector<std::string>& projected_attributes) {
+  std::vector<std::string> referenced;
+  if (content[1] == "template") {
+    referenced = extract_substrings(content[0]);
+  } else if (content[1] == "reference") {
+    referenced.push_back(content[0]);
+  }
+
+  std::vector<std::string> missing;
+  for (const auto& attribute : referenced) {
+    if (std::find(projected_attributes.begin(), projected_attributes.end(), attribute) == projected_attributes.end()) {
+      missing.push_back(attribute);
+    }
+  }
+  return missing;
+}
+
+// Blanks the attributes a plan does not project in the row map and restores them when it goes
+// out of scope, so the row map of the union projection is not copied per plan.
+class RowRestriction {
+ public:
+  RowRestriction(std::unordered_map<std::string, std::string>& row, const std::vector<std::string>& missing) : row_(row), missing_(missing) {
+    saved_.reserve(missing.size());
+    for (const auto& attribute : missing) {
+      auto [it, inserted] = row.try_emplace(attribute);
+      saved_.emplace_back(inserted, std::move(it->second));
+      it->second.clear();
+    }
+  }
+
+  // Restored in reverse, an attribute missing twice gets the value saved first
+  ~RowRestriction() {
+    for (size_t i = missing_.size(); i-- > 0;) {
+      if (saved_[i].first) {
+        row_.erase(missing_[i]);
+      } else {
+        row_[missing_[i]] = std::move(saved_[i].second);
+      }
+    }
+  }
+
+  RowRestriction(const RowRestriction&) = delete;
+  RowRestriction& operator=(const RowRestriction&) = delete;
+
+ private:
+  std::unordered_map<std::string, std::string>& row_;
+  const std::vector<std::string>& missing_;
+  std::vector<std::pair<bool, std::string>> saved_;  // added by the restriction, value before
+};
+
+// Index of the shared term with the same term map, base and missing attributes, adds it if new
+static size_t shared_term_index(std::vector<SharedTerm>& terms, const std::vector<std::string>& content, const std::string& base_uri,
+                                const std::vector<std::string>& projected_attributes) {
+  std::vector<std::string> missing = missing_attributes(content, projected_attributes);
+  for (size_t i = 0; i < terms.size(); ++i) {
+    if (*terms[i].content == content && *terms[i].base_uri == base_uri && terms[i].missing == missing) {
+      return i;
+    }
+  }
+  terms.emplace_back(&content, &base_uri, std::move(missing));
+  return terms.size() - 1;
+}
+
+// Value of a shared term for the current row, throws the error of the first attempt again
+static const std::string& build_shared_term(SharedTerm& term, size_t row_number, std::unordered_map<std::string, std::string>& row) {
+  if (term.row_number != row_number) {
+    term.row_number = row_number;
+    term.failed = false;
+    const std::vector<std::string>& content = *term.content;
+    try {
+      if (content[1] == "preformatted") {
+        term.value = content[0];
+      } else if (term.missing.empty()) {
+        term.value = create_operator(content[0], content[1], content[2], "", "", *term.base_uri, row);
+      } else {
+        RowRestriction restricted(row, term.missing);
+        term.value = create_operator(content[0], content[1], content[2], "", "", *term.base_uri, row);
+      }
+    } catch (const std::runtime_error& e) {
+      term.failed = true;
+      term.error = e.what();
+    }
+  }
+  if (term.failed) {
+    throw std::runtime_error(term.error);
+  }
+  return term.value;
+}
+
+// Lines of a source processed by one task of a chunked scan
+constexpr size_t scan_chunk_lines = 8 * 1024;
+
+// Read the remaining lines of file in chunks and process them. Inside the scheduler the chunks of
+// a round become subtasks that idle workers steal, the calling thread takes the first chunk and
+// reads the next round once the round is done. Otherwise the chunks run on the calling thread.
+static void scan_in_chunks(std::istream& file, Scheduler* scheduler, const std::function<void(const std::vector<std::string>&)>& process_chunk) {
+  size_t round_size = scheduler == nullptr ? 1 : 2 * scheduler->num_workers();
+  std::vector<std::vector<std::string>> chunks(round_size);
+  std::string line;
+  bool more = true;
+  while (more) {
+    size_t filled = 0;
+    while (more && filled < round_size) {
+      std::vector<std::string>& chunk = chunks[filled];
+      chunk.clear();
+      while (chunk.size() < scan_chunk_lines && std::getline(file, line)) {
+        chunk.push_back(std::move(line));
+      }
+      more = chunk.size() == scan_chunk_lines;
+      filled += chunk.empty() ? 0 : 1;
+    }
+
+    if (scheduler == nullptr || filled <= 1) {
+      for (size_t c = 0; c < filled; ++c) {
+        process_chunk(chunks[c]);
+      }
+      continue;
+    }
+    TaskGroup round(*scheduler);
+    for (size_t c = 1; c < filled; ++c) {
+      round.run([&process_chunk, &chunks, c] { process_chunk(chunks[c]); });
+    }
+    process_chunk(chunks[0]);
+    round.wait();
+  }
+}
+
+// Scan the source once and feed every plan. Returns the number of generated triple.
+// Inside the scheduler the rows are split into chunks processed in parallel, the plans
+// share their duplicate elimination across the chunks. Dependent plans scan on one thread.
+static size_t execute_fused_scan(std::vector<FusedPlan>& plans,
+                                 const std::unordered_map<std::string, std::string>& data_map) {
+  bool dependent = plans[0].unique_triple != nullptr;
+  OutputWriter* output = dependent ? nullptr : &output_writer(plans[0].info.output_file_name);
+
+  // Open input
+  const std::string& input_file_name = plans[0].info.input_file_name;
+  auto file = open_from_map_or_file(data_map, input_file_name);
+  if (file == nullptr) {
+    std::cerr << "Error opening file: " << input_file_name << std::endl;
+    std::exit(1);
+  }
+
+  // Read and split header, resolve the projection of every plan and the union of all projections
+  std::string header_line;
+  std::getline(*file, header_line);
+  std::vector<std::string> header = split_csv_line(header_line, ',');
+  std::vector<int> union_indices;
+  std::vector<SharedTerm> shared_terms;
+  for (auto& plan : plans) {
+    plan.projected_indices = get_attribute_index(*file, header, plan.info.projected_attributes);
+    for (int i : plan.projected_indices) {
+      if (std::find(union_indices.begin(), union_indices.end(), i) == union_indices.end()) {
+        union_indices.push_back(i);
+      }
+    }
+    const std::vector<std::string>& projected_attributes = plan.info.projected_attributes;
+    plan.subject_term = shared_term_index(shared_terms, plan.info.s_content, plan.info.base_uri, projected_attributes);
+    if (plan.info.generate_graph) {
+      plan.graph_term = shared_term_index(shared_terms, plan.info.g_content, plan.info.base_uri, projected_attributes);
+    }
+    plan.missing_po = missing_attributes(plan.info.p_content, projected_attributes);
+    for (const auto& attribute : missing_attributes(plan.info.o_content, projected_attributes)) {
+      plan.missing_po.push_back(attribute);
+    }
+  }
+
+  std::atomic<size_t> triple_counter{0};
+  auto process_chunk = [&](const std::vector<std::string>& lines) {
+    SetupData setup_data = initialize_setup_dependent(plans[0].info.output_file_name);
+    setup_data.output = output;
+    // Shared terms cache the value of their row, every chunk builds its own
+    std::vector<SharedTerm> terms = shared_terms;
+    // Map of the union projection, the keys stay and the values are replaced for every row
+    std::unordered_map<std::string, std::string> row;
+    size_t row_number = 0;
+    bool row_created = false;
+
+    for (const std::string& line : lines) {
+      setup_data.split_line = split_csv_line(line, ',');
+      row_number++;
+      row_created = false;
+
+      for (auto& plan : plans) {
+        ////// PROJECTION //////
+        setup_data.projected_row.clear();
+        for (int i : plan.projected_indices) {
+          setup_data.projected_row.push_back(setup_data.split_line[i]);
+        }
+
+        // Check for NULL values
+        setup_data.skip = false;
+        for (const auto& target : values_to_skip) {
+          if (std::any_of(setup_data.projected_row.begin(), setup_data.projected_row.end(), [&target](const std::string& s) { return s == target; })) {
+            setup_data.skip = true;
+            break;
+          }
+        }
+        if (setup_data.skip) {
+          continue;
+        }
+
+        // Eliminate duplicates
+        setup_data.hash = combinedHash(setup_data.projected_row);
+        if (!plan.unique_hashes->insert(setup_data.hash)) {
+          continue;
+        }
+
+        // Create map of row once for all plans
+        if (!row_created) {
+          for (int i : union_indices) {
+            row[header[i]] = setup_data.split_line[i];
+          }
+          row_created = true;
+        }
+
+        ////// CREATE //////
+        const ParsedContent& info = plan.info;
+        try {
+          // SUBJECT
+          setup_data.subject = build_shared_term(terms[plan.subject_term], row_number, row);
+          {
+            RowRestriction restricted(row, plan.missing_po);
+            // PREDICATE
+            if (info.p_content[1] == "preformatted") {
+              setup_data.predicate = info.p_content[0];
+            } else {
+              setup_data.predicate = create_operator(info.p_content[0], info.p_content[1], info.p_content[2], "", "", info.base_uri, row);
+            }
+            // OBJECT
+            if (info.o_content[1] == "preformatted") {
+              setup_data.object = info.o_content[0];
+            } else {
+              setup_data.object = create_operator(info.o_content[0], info.o_content[1], info.o_content[2], info.o_content[3], info.o_content[4], info.base_uri, row);
+            }
+          }
+          // GRAPH
+          if (info.generate_graph) {
+            setup_data.graph = build_shared_term(terms[plan.graph_term], row_number, row);
+          }
+        } catch (const std::runtime_error& e) {
+          if (continue_on_error == false) {
+            std::cout << e.what() << std::endl;
+            std::exit(1);
+          } else {
+            continue;
+          }
+        }
+
+        setup_data.res = setup_data.subject + " " + setup_data.predicate + " " + setup_data.object;
+        if (info.generate_graph) {
+          setup_data.res += " " + setup_data.graph;
+        }
+        setup_data.res += " .\n";
+
+        if (plan.unique_triple != nullptr) {
+          plan.unique_triple->insert(setup_data.res);
+          continue;
+        }
+        setup_data.triple_counter++;
+        setup_data.buffered_res += setup_data.res;
+        setup_data.write_cnt++;
+
+        if (setup_data.write_cnt == setup_data.buffer_limit) {
+          setup_data.write_cnt = 0;
+          ////// SERIALIZE //////
+          setup_data.output->write(setup_data.buffered_res);
+        }
+      }
+    }
+    ////// SERIALIZE //////
+    if (setup_data.output != nullptr) {
+      setup_data.output->write(setup_data.buffered_res);
+    }
+    triple_counter.fetch_add(setup_data.triple_counter, std::memory_order_relaxed);
+  };
+
+  scan_in_chunks(*file, dependent ? nullptr : Scheduler::current(), process_chunk);
+  return triple_counter.load();
+}
+
+size_t fused_simple_mapping(const std::vector<std::string>& plans, const std::unordered_map<std::string, std::string>& data_map) {
+  std::vector<FusedPlan> fused_plans(plans.size());
+  for (size_t i = 0; i < plans.size(); ++i) {
+    fused_plans[i].info = parse_information(plans[i]);
+  }
+  return execute_fused_scan(fused_plans, data_map);
+}
+
+void fused_dependent_simple_mapping(const std::vector<std::string>& plans, const std::vector<TripleCollector*>& unique_triples,
+                                    const std::unordered_map<std::string, std::string>& data_map) {
+  std::vector<FusedPlan> fused_plans(plans.size());
+  for (size_t i = 0; i < plans.size(); ++i) {
+    fused_plans[i].info = parse_information(plans[i]);
+    fused_plans[i].unique_triple = unique_triples[i];
+  }
+  execute_fused_scan(fused_plans, data_map);
 }
@@ -5,5 +5,13 @@
 #include <unordered_set>
 #include <unordered_map>
 
+#include "triple_collector.h"
+
 size_t standalone_simple_mapping(const std::string& information, const std::unordered_map<std::string, std::string>& data_map);
-std::unordered_set<std::string> dependent_simple_mapping(const std::string& information, std::unordered_set<std::string>& unique_triple, const std::unordered_map<std::string, std::string>& data_map);
\ No newline at end of file
+void dependent_simple_mapping(const std::string& information, TripleCollector& unique_triple, const std::unordered_map<std::string, std::string>& data_map);
+// Input file read by a simple plan, empty if the plan is constant and reads no source.
+std::string simple_plan_source(const std::string& information);
+// Execute simple plans reading the same source in a single pass over it.
+size_t fused_simple_mapping(const std::vector<std::string>& plans, const std::unordered_map<std::string, std::string>& data_map);
+void fused_dependent_simple_mapping(const std::vector<std::string>& plans, const std::vector<TripleCollector*>& unique_triples,
+                                    const std::unordered_map<std::string, std::string>& data_map);
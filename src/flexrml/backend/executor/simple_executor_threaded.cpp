@@ -1,82 +1,31 @@
 #include <algorithm>
 #include <atomic>
-#include <condition_variable>
+#include <chrono>
 #include <exception>
 #include <filesystem>
 #include <format>
 #include <fstream>
 #include <functional>
 #include <iostream>
-#include <mutex>
-#include <queue>
 #include <string>
 #include <thread>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
 
+#include "adaptive_chunking.h"
 #include "definitions.h"
+#include "mpmc_queue.h"
+#include "output_writer.h"
+#include "resource_manager.h"
 #include "utils.h"
 
 namespace fs = std::filesystem;
 
-//////////////////////////////////////////////////////////////////////////////////////////////////////////
-/// Thread-safe Bounded Queue (template)
-//////////////////////////////////////////////////////////////////////////////////////////////////////////
-template <typename T>
-class BoundedThreadSafeQueue {
- public:
-  explicit BoundedThreadSafeQueue(size_t capacity) : capacity_(capacity) {}
-
-  void push(T value) {
-    std::unique_lock<std::mutex> lock(mtx_);
-    cond_push_.wait(lock,
-                    [this] { return queue_.size() < capacity_ || finished_; });
-    if (finished_) return;
-    queue_.push(std::move(value));
-    cond_pop_.notify_one();
-  }
-
-  bool pop(T& value) {
-    std::unique_lock<std::mutex> lock(mtx_);
-    cond_pop_.wait(lock, [this] { return !queue_.empty() || finished_; });
-    if (queue_.empty()) return false;
-    value = std::move(queue_.front());
-    queue_.pop();
-    cond_push_.notify_one();
-    return true;
-  }
-
-  void set_finished() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    finished_ = true;
-    cond_pop_.notify_all();
-    cond_push_.notify_all();
-  }
-
-  // Add this method to get the current size safely
-  size_t size() {
-    std::lock_guard<std::mutex> lock(mtx_);
-    return queue_.size();
-  }
-
- private:
-  std::queue<T> queue_;
-  std::mutex mtx_;
-  std::condition_variable cond_pop_, cond_push_;
-  bool finished_ = false;
-  size_t capacity_;
-};
-
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 void handle_constant_preformatted(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
                                   const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
                                   const fs::path& output_file_name, std::unordered_set<uint64_t>& global_hashes) {
-  std::ofstream outputFile(output_file_name, std::ios::app);
-  if (!outputFile) {
-    std::cout << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
   std::vector<std::string> val;
   if (g_content.empty()) {
     val = {s_content[0], p_content[0], o_content[0]};
@@ -91,20 +40,62 @@ void handle_constant_preformatted(const std::vector<std::string>& s_content, con
   }
   global_hashes.insert(rowHash);
 
+  std::string triple;
   for (const auto& element : val) {
-    outputFile << element + " ";
+    triple += element + " ";
   }
-  outputFile << ".\n";
+  triple += ".\n";
+  output_writer(output_file_name).write(triple);
 }
 
+// Capacity of the queues, the adaptive queue depth stays below it
+static size_t max_queue_depth(size_t producers) { return std::clamp<size_t>(4 * producers, 8, 256); }
+
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 /// Main Execution Dependent
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
-// store chunk as vector of strings
-using CSVChunk = std::vector<std::vector<std::string>>;
-// producers process triple strings in chunks
-using TripleChunk = std::vector<std::string>;
+// store chunk as rows of projected fields, rows past size are kept for reuse
+struct CSVChunk {
+  std::vector<std::vector<std::string>> rows;
+  size_t size = 0;
+  void reset() { size = 0; }
+};
+// producers process triple strings in chunks, strings past size are kept for reuse
+struct TripleChunk {
+  std::vector<std::string> triples;
+  size_t size = 0;
+  void reset() { size = 0; }
+};
+
+// Copy the projected fields of a line into the next row of the chunk.
+// Assigning into the recycled strings avoids allocating for every field.
+static void append_projected_row(CSVChunk& chunk, const std::vector<std::string>& split_line,
+                                 const std::vector<int>& projected_indexes) {
+  if (chunk.size == chunk.rows.size()) {
+    chunk.rows.emplace_back();
+  }
+  std::vector<std::string>& fields = chunk.rows[chunk.size++];
+  fields.resize(projected_indexes.size());
+  for (size_t j = 0; j < projected_indexes.size(); j++) {
+    int idx = projected_indexes[j];
+    if (idx >= 0 && idx < (int)split_line.size()) {
+      fields[j].assign(split_line[idx]);
+    } else {
+      fields[j].clear();
+    }
+  }
+}
+
+// Next empty triple string of the chunk
+static std::string& next_triple(TripleChunk& chunk) {
+  if (chunk.size == chunk.triples.size()) {
+    chunk.triples.emplace_back();
+  }
+  std::string& triple = chunk.triples[chunk.size++];
+  triple.clear();
+  return triple;
+}
 
 std::unordered_set<uint64_t> execute_dependent(
     const std::string& input_file_name, const fs::path& output_file_name,
@@ -149,57 +140,44 @@ std::unordered_set<uint64_t> execute_dependent(
   std::vector<std::string> projected_header = projected_attributes;
 
   // --------------------------------------
-  // thread-safe queues
-  const int chunks_to_buffer = 10;
-  const size_t QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
+  // producers are leased from the CPU budget
+  ThreadLease producer_lease(ResourceManager::instance().budget());
+  unsigned int NUM_PRODUCERS = producer_lease.count();
+
+  // lock-free queues, chunk size and queue depth adapt to the rows within their capacity
+  const size_t QUEUE_CAPACITY = max_queue_depth(NUM_PRODUCERS);
+  AdaptiveChunking chunking(NUM_PRODUCERS, QUEUE_CAPACITY);
+  BoundedMPMCQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
+
+  const size_t TRIPLE_QUEUE_CAPACITY = QUEUE_CAPACITY;
+  BoundedMPMCQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
 
-  const size_t TRIPLE_QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
+  // drained chunks go back to the pools, enough for every chunk in flight
+  ChunkPool<CSVChunk> csvPool(QUEUE_CAPACITY + NUM_PRODUCERS + 1);
+  ChunkPool<TripleChunk> triplePool(TRIPLE_QUEUE_CAPACITY + NUM_PRODUCERS + 1);
 
   // --------------------------------------
   // setup Reader thread: read lines in chunks + deduplicate
-  const size_t CHUNK_SIZE = 200;  // lines per chunk
   std::thread reader([&]() {
-    // std::unordered_set<uint64_t> global_hashes;
-    // global_hashes.reserve(1024 * 1024);
-
-    CSVChunk chunk;
-    chunk.reserve(CHUNK_SIZE);
+    CSVChunk chunk = csvPool.acquire();
+    size_t chunk_bytes = 0;
 
     std::string line;
     while (std::getline(file, line)) {
-      // Parse and get projected fields
+      chunk_bytes += line.size() + 1;
+      // Parse and add projected fields to chunk
       auto split_line = split_csv_line(line, ',');
-
-      std::vector<std::string> projectedFields;
-      projectedFields.reserve(projected_indexes.size());
-      for (int idx : projected_indexes) {
-        if (idx >= 0 && idx < (int)split_line.size()) {
-          projectedFields.push_back(split_line[idx]);
-        } else {
-          projectedFields.push_back("");
-        }
-      }
-
-      // Deduplicate
-      // uint64_t rowHash = combinedHash(projectedFields);
-      // if (global_hashes.find(rowHash) != global_hashes.end()) {
-      // skip
-      // continue;
-      //}
-      // global_hashes.insert(rowHash);
-
-      // Add to chunk
-      chunk.push_back(std::move(projectedFields));
-      if (chunk.size() >= CHUNK_SIZE) {
+      append_projected_row(chunk, split_line, projected_indexes);
+      if (chunk.size >= chunking.chunk_rows()) {
+        chunking.chunk_read(chunk.size, chunk_bytes);
+        chunk_bytes = 0;
         lineQueue.push(std::move(chunk));
-        chunk.clear();
-        chunk.reserve(CHUNK_SIZE);
+        chunk = csvPool.acquire();
       }
     }
     // push last partial chunk if not empty
-    if (!chunk.empty()) {
+    if (chunk.size > 0) {
+      chunking.chunk_read(chunk.size, chunk_bytes);
       lineQueue.push(std::move(chunk));
     }
     file.close();
@@ -208,29 +186,45 @@ std::unordered_set<uint64_t> execute_dependent(
 
   // --------------------------------------
   // Producer threads: transform chunk of CSV -> chunk of triple strings
-  unsigned int NUM_PRODUCERS = std::thread::hardware_concurrency();
-  if (NUM_PRODUCERS == 0) {
-    NUM_PRODUCERS = 2;  // fallback
-  }
-
   std::vector<std::thread> producers;
   producers.reserve(NUM_PRODUCERS);
 
   for (unsigned int i = 0; i < NUM_PRODUCERS; i++) {
     producers.emplace_back([&]() {
       CSVChunk csvChunk;
-      while (lineQueue.pop(csvChunk)) {
+      for (;;) {
+        // starved if the producer has to wait for the reader
+        bool starved = !lineQueue.try_pop(csvChunk);
+        if (starved && !lineQueue.pop(csvChunk)) {
+          break;
+        }
+        auto chunk_start = std::chrono::steady_clock::now();
+
         // Build a TripleChunk
-        TripleChunk tripleChunk;
-        tripleChunk.reserve(csvChunk.size());
+        TripleChunk tripleChunk = triplePool.acquire();
 
-        for (auto& rowFields : csvChunk) {
+        for (size_t row = 0; row < csvChunk.size; row++) {
+          const std::vector<std::string>& rowFields = csvChunk.rows[row];
           // create a map from projected_header
           std::unordered_map<std::string, std::string> rowMap;
           for (size_t j = 0; j < rowFields.size(); j++) {
             rowMap[projected_header[j]] = rowFields[j];
           }
 
+          // Check for NULL values
+          bool skip = false;
+          for (const auto& target : values_to_skip) {
+            if (std::any_of(rowMap.begin(), rowMap.end(), [&target](const auto& pair) {
+                  return pair.second == target;
+                })) {
+              skip = true;
+              break;
+            }
+          }
+          if (skip) {
+            continue;
+          }
+
           ////// CREATE //////
           std::string subject;
           std::string predicate;
@@ -266,9 +260,10 @@ std::unordered_set<uint64_t> execute_dependent(
             }
           }
 
-          std::string tripleStr = subject + " " + predicate + " " + object + " .\n";
-          tripleChunk.push_back(std::move(tripleStr));
+          next_triple(tripleChunk).append(subject).append(" ").append(predicate).append(" ").append(object).append(" .\n");
         }
+        chunking.chunk_processed(csvChunk.size, std::chrono::steady_clock::now() - chunk_start, starved);
+        csvPool.release(std::move(csvChunk));
 
         // push the tripleChunk
         tripleQueue.push(std::move(tripleChunk));
@@ -277,21 +272,17 @@ std::unordered_set<uint64_t> execute_dependent(
   }
 
   // --------------------------------------
-  // Consumer thread: write triple chunks to file
+  // Consumer thread: hand deduplicated triples to the output writer
   std::thread consumer([&]() {
     // pop entire TripleChunks and write them in one go
     TripleChunk tripleChunk;
-    std::ofstream outputFile(output_file_name, std::ios::app);
-    if (!outputFile) {
-      std::cout << "Error: Unable to open file for writing." << std::endl;
-      std::exit(1);
-    }
-    size_t counter = 0;
+    OutputWriter& output = output_writer(output_file_name);
     std::string buffer = "";
     buffer.reserve(1024);
     while (tripleQueue.pop(tripleChunk)) {
       // Write everything
-      for (auto& t : tripleChunk) {
+      for (size_t i = 0; i < tripleChunk.size; i++) {
+        const std::string& t = tripleChunk.triples[i];
         // Deduplicate
         std::vector<std::string> val = {t};
         uint64_t rowHash = combinedHash(val);
@@ -301,20 +292,16 @@ std::unordered_set<uint64_t> execute_dependent(
         }
         global_hashes.insert(rowHash);
         buffer += t;
-        counter++;
 
-        if (counter == 50) {
-          outputFile << buffer;
-          buffer = "";
-          counter = 0;
+        // Hand over large buffers, small writes fragment the file and the Turtle subject groups
+        if (buffer.size() >= OutputWriter::compression_block_size) {
+          output.write(buffer);
         }
       }
+      triplePool.release(std::move(tripleChunk));
     }
     // Flush any remaining content in the buffer
-    if (!buffer.empty()) {
-      outputFile << buffer;
-    }
-    outputFile.close();
+    output.write(buffer);
   });
 
   // --------------------------------------
@@ -326,6 +313,7 @@ std::unordered_set<uint64_t> execute_dependent(
 
   tripleQueue.set_finished();
   consumer.join();
+  record_chunking_stats(chunking.stats());
 
   return global_hashes;
 }
@@ -378,46 +366,44 @@ size_t execute(const std::string& input_file_name,
   std::vector<std::string> projected_header = projected_attributes;
 
   // --------------------------------------
-  // thread-safe queues
-  const int chunks_to_buffer = 20;
-  const size_t QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
+  // producers are leased from the CPU budget
+  ThreadLease producer_lease(ResourceManager::instance().budget());
+  unsigned int NUM_PRODUCERS = producer_lease.count();
+
+  // lock-free queues, chunk size and queue depth adapt to the rows within their capacity
+  const size_t QUEUE_CAPACITY = max_queue_depth(NUM_PRODUCERS);
+  AdaptiveChunking chunking(NUM_PRODUCERS, QUEUE_CAPACITY);
+  BoundedMPMCQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
 
-  const size_t TRIPLE_QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
+  const size_t TRIPLE_QUEUE_CAPACITY = QUEUE_CAPACITY;
+  BoundedMPMCQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
+
+  // drained chunks go back to the pools, enough for every chunk in flight
+  ChunkPool<CSVChunk> csvPool(QUEUE_CAPACITY + NUM_PRODUCERS + 1);
+  ChunkPool<TripleChunk> triplePool(TRIPLE_QUEUE_CAPACITY + NUM_PRODUCERS + 1);
 
   // --------------------------------------
   // setup Reader thread: read lines in chunks + deduplicate
-  const size_t CHUNK_SIZE = 50;  // lines per chunk
   std::thread reader([&]() {
-    CSVChunk chunk;
-    chunk.reserve(CHUNK_SIZE);
+    CSVChunk chunk = csvPool.acquire();
+    size_t chunk_bytes = 0;
 
     std::string line;
     while (std::getline(file, line)) {
-      // Parse and get projected fields
+      chunk_bytes += line.size() + 1;
+      // Parse and add projected fields to chunk
       auto split_line = split_csv_line(line, ',');
-
-      std::vector<std::string> projectedFields;
-      projectedFields.reserve(projected_indexes.size());
-      for (int idx : projected_indexes) {
-        if (idx >= 0 && idx < (int)split_line.size()) {
-          projectedFields.push_back(split_line[idx]);
-        } else {
-          projectedFields.push_back("");
-        }
-      }
-
-      // Add to chunk
-      chunk.push_back(std::move(projectedFields));
-      if (chunk.size() >= CHUNK_SIZE) {
+      append_projected_row(chunk, split_line, projected_indexes);
+      if (chunk.size >= chunking.chunk_rows()) {
+        chunking.chunk_read(chunk.size, chunk_bytes);
+        chunk_bytes = 0;
         lineQueue.push(std::move(chunk));
-        chunk.clear();
-        chunk.reserve(CHUNK_SIZE);
+        chunk = csvPool.acquire();
       }
     }
     // push last partial chunk if not empty
-    if (!chunk.empty()) {
+    if (chunk.size > 0) {
+      chunking.chunk_read(chunk.size, chunk_bytes);
       lineQueue.push(std::move(chunk));
     }
     file.close();
@@ -426,11 +412,6 @@ size_t execute(const std::string& input_file_name,
 
   // --------------------------------------
   // Producer threads: transform chunk of CSV -> chunk of triple strings
-  unsigned int NUM_PRODUCERS = std::thread::hardware_concurrency();
-  if (NUM_PRODUCERS == 0) {
-    NUM_PRODUCERS = 2;  // fallback
-  }
-
   std::vector<std::thread> producers;
   producers.reserve(NUM_PRODUCERS);
 
@@ -438,17 +419,24 @@ size_t execute(const std::string& input_file_name,
     producers.emplace_back([&]() {
       size_t local_triple_count = 0;  // Thread-local counter
       CSVChunk csvChunk;
-      while (lineQueue.pop(csvChunk)) {
+      for (;;) {
+        // starved if the producer has to wait for the reader
+        bool starved = !lineQueue.try_pop(csvChunk);
+        if (starved && !lineQueue.pop(csvChunk)) {
+          break;
+        }
+        auto chunk_start = std::chrono::steady_clock::now();
+
         // Log current queue size (this logs the lineQueue size in the producer
         // thread)
         // std::cout << "[Producer " << std::this_thread::get_id()
         //          << "] lineQueue size: " << lineQueue.size() << "\n";
 
         // Build a TripleChunk for the current CSV chunk.
-        TripleChunk tripleChunk;
-        tripleChunk.reserve(csvChunk.size());
+        TripleChunk tripleChunk = triplePool.acquire();
 
-        for (auto& rowFields : csvChunk) {
+        for (size_t row = 0; row < csvChunk.size; row++) {
+          const std::vector<std::string>& rowFields = csvChunk.rows[row];
           // Create a map from projected_header.
           std::unordered_map<std::string, std::string> rowMap;
           for (size_t j = 0; j < rowFields.size(); j++) {
@@ -496,12 +484,13 @@ size_t execute(const std::string& input_file_name,
             }
           }
 
-          std::string tripleStr = subject + " " + predicate + " " + object + " .\n";
-          tripleChunk.push_back(std::move(tripleStr));
+          next_triple(tripleChunk).append(subject).append(" ").append(predicate).append(" ").append(object).append(" .\n");
         }
+        chunking.chunk_processed(csvChunk.size, std::chrono::steady_clock::now() - chunk_start, starved);
+        csvPool.release(std::move(csvChunk));
 
         // Accumulate count.
-        local_triple_count += tripleChunk.size();
+        local_triple_count += tripleChunk.size;
 
         // Push the chunk
         tripleQueue.push(std::move(tripleChunk));
@@ -521,25 +510,19 @@ size_t execute(const std::string& input_file_name,
     });
   }
   // --------------------------------------
-  // Consumer thread: write triple chunks to file
+  // Consumer thread: hand deduplicated triples to the output writer
   std::thread consumer([&]() {
-    fs::create_directories(output_file_name.parent_path());
-
-    std::ofstream outputFile(output_file_name, std::ios::app);
-    if (!outputFile) {
-      std::cerr << "Cannot open output file: " << output_file_name << "\n";
-      return;
-    }
+    OutputWriter& output = output_writer(output_file_name);
     std::unordered_set<uint64_t> global_hashes;
     global_hashes.reserve(1024 * 1024 * 2);
     // pop entire TripleChunks and write them in one go
     TripleChunk tripleChunk;
-    size_t counter = 0;
     std::string buffer = "";
     buffer.reserve(1024 * 30);
     while (tripleQueue.pop(tripleChunk)) {
       // Write everything
-      for (auto& t : tripleChunk) {
+      for (size_t i = 0; i < tripleChunk.size; i++) {
+        const std::string& t = tripleChunk.triples[i];
         // Deduplicate
         std::vector<std::string> val = {t};
         uint64_t rowHash = combinedHash(val);
@@ -549,20 +532,16 @@ size_t execute(const std::string& input_file_name,
         }
         global_hashes.insert(rowHash);
         buffer += t;
-        counter++;
 
-        if (counter == 500) {
-          outputFile << buffer;
-          buffer = "";
-          counter = 0;
+        // Hand over large buffers, small writes fragment the file and the Turtle subject groups
+        if (buffer.size() >= OutputWriter::compression_block_size) {
+          output.write(buffer);
         }
       }
+      triplePool.release(std::move(tripleChunk));
     }
     // Flush any remaining content in the buffer
-    if (!buffer.empty()) {
-      outputFile << buffer;
-    }
-    outputFile.close();
+    output.write(buffer);
   });
 
   // --------------------------------------
@@ -574,6 +553,7 @@ size_t execute(const std::string& input_file_name,
 
   tripleQueue.set_finished();
   consumer.join();
+  record_chunking_stats(chunking.stats());
 
   return triple_count.load();
 }
@@ -624,46 +604,44 @@ size_t execute_with_graph(const std::string& input_file_name,
   std::vector<std::string> projected_header = projected_attributes;
 
   // --------------------------------------
-  // thread-safe queues
-  const int chunks_to_buffer = 20;
-  const size_t QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
+  // producers are leased from the CPU budget
+  ThreadLease producer_lease(ResourceManager::instance().budget());
+  unsigned int NUM_PRODUCERS = producer_lease.count();
+
+  // lock-free queues, chunk size and queue depth adapt to the rows within their capacity
+  const size_t QUEUE_CAPACITY = max_queue_depth(NUM_PRODUCERS);
+  AdaptiveChunking chunking(NUM_PRODUCERS, QUEUE_CAPACITY);
+  BoundedMPMCQueue<CSVChunk> lineQueue(QUEUE_CAPACITY);
+
+  const size_t TRIPLE_QUEUE_CAPACITY = QUEUE_CAPACITY;
+  BoundedMPMCQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
 
-  const size_t TRIPLE_QUEUE_CAPACITY = chunks_to_buffer;
-  BoundedThreadSafeQueue<TripleChunk> tripleQueue(TRIPLE_QUEUE_CAPACITY);
+  // drained chunks go back to the pools, enough for every chunk in flight
+  ChunkPool<CSVChunk> csvPool(QUEUE_CAPACITY + NUM_PRODUCERS + 1);
+  ChunkPool<TripleChunk> triplePool(TRIPLE_QUEUE_CAPACITY + NUM_PRODUCERS + 1);
 
   // --------------------------------------
   // setup Reader thread: read lines in chunks + deduplicate
-  const size_t CHUNK_SIZE = 50;  // lines per chunk
   std::thread reader([&]() {
-    CSVChunk chunk;
-    chunk.reserve(CHUNK_SIZE);
+    CSVChunk chunk = csvPool.acquire();
+    size_t chunk_bytes = 0;
 
     std::string line;
     while (std::getline(file, line)) {
-      // Parse and get projected fields
+      chunk_bytes += line.size() + 1;
+      // Parse and add projected fields to chunk
       auto split_line = split_csv_line(line, ',');
-
-      std::vector<std::string> projectedFields;
-      projectedFields.reserve(projected_indexes.size());
-      for (int idx : projected_indexes) {
-        if (idx >= 0 && idx < (int)split_line.size()) {
-          projectedFields.push_back(split_line[idx]);
-        } else {
-          projectedFields.push_back("");
-        }
-      }
-
-      // Add to chunk
-      chunk.push_back(std::move(projectedFields));
-      if (chunk.size() >= CHUNK_SIZE) {
+      append_projected_row(chunk, split_line, projected_indexes);
+      if (chunk.size >= chunking.chunk_rows()) {
+        chunking.chunk_read(chunk.size, chunk_bytes);
+        chunk_bytes = 0;
         lineQueue.push(std::move(chunk));
-        chunk.clear();
-        chunk.reserve(CHUNK_SIZE);
+        chunk = csvPool.acquire();
       }
     }
     // push last partial chunk if not empty
-    if (!chunk.empty()) {
+    if (chunk.size > 0) {
+      chunking.chunk_read(chunk.size, chunk_bytes);
       lineQueue.push(std::move(chunk));
     }
     file.close();
@@ -672,11 +650,6 @@ size_t execute_with_graph(const std::string& input_file_name,
 
   // --------------------------------------
   // Producer threads: transform chunk of CSV -> chunk of triple strings
-  unsigned int NUM_PRODUCERS = std::thread::hardware_concurrency();
-  if (NUM_PRODUCERS == 0) {
-    NUM_PRODUCERS = 2;  // fallback
-  }
-
   std::vector<std::thread> producers;
   producers.reserve(NUM_PRODUCERS);
 
@@ -684,17 +657,24 @@ size_t execute_with_graph(const std::string& input_file_name,
     producers.emplace_back([&]() {
       size_t local_triple_count = 0;  // Thread-local counter
       CSVChunk csvChunk;
-      while (lineQueue.pop(csvChunk)) {
+      for (;;) {
+        // starved if the producer has to wait for the reader
+        bool starved = !lineQueue.try_pop(csvChunk);
+        if (starved && !lineQueue.pop(csvChunk)) {
+          break;
+        }
+        auto chunk_start = std::chrono::steady_clock::now();
+
         // Log current queue size (this logs the lineQueue size in the producer
         // thread)
         // std::cout << "[Producer " << std::this_thread::get_id()
         //          << "] lineQueue size: " << lineQueue.size() << "\n";
 
         // Build a TripleChunk for the current CSV chunk.
-        TripleChunk tripleChunk;
-        tripleChunk.reserve(csvChunk.size());
+        TripleChunk tripleChunk = triplePool.acquire();
 
-        for (auto& rowFields : csvChunk) {
+        for (size_t row = 0; row < csvChunk.size; row++) {
+          const std::vector<std::string>& rowFields = csvChunk.rows[row];
           // Create a map from projected_header.
           std::unordered_map<std::string, std::string> rowMap;
           for (size_t j = 0; j < rowFields.size(); j++) {
@@ -747,12 +727,13 @@ size_t execute_with_graph(const std::string& input_file_name,
             }
           }
 
-          std::string tripleStr = subject + " " + predicate + " " + object + " " + graph + " .\n";
-          tripleChunk.push_back(std::move(tripleStr));
+          next_triple(tripleChunk).append(subject).append(" ").append(predicate).append(" ").append(object).append(" ").append(graph).append(" .\n");
         }
+        chunking.chunk_processed(csvChunk.size, std::chrono::steady_clock::now() - chunk_start, starved);
+        csvPool.release(std::move(csvChunk));
 
         // Accumulate count.
-        local_triple_count += tripleChunk.size();
+        local_triple_count += tripleChunk.size;
 
         // Push the chunk
         tripleQueue.push(std::move(tripleChunk));
@@ -772,25 +753,19 @@ size_t execute_with_graph(const std::string& input_file_name,
     });
   }
   // --------------------------------------
-  // Consumer thread: write triple chunks to file
+  // Consumer thread: hand deduplicated triples to the output writer
   std::thread consumer([&]() {
-    fs::create_directories(output_file_name.parent_path());
-
-    std::ofstream outputFile(output_file_name, std::ios::app);
-    if (!outputFile) {
-      std::cerr << "Cannot open output file: " << output_file_name << "\n";
-      return;
-    }
+    OutputWriter& output = output_writer(output_file_name);
     std::unordered_set<uint64_t> global_hashes;
     global_hashes.reserve(1024 * 1024 * 2);
     // pop entire TripleChunks and write them in one go
     TripleChunk tripleChunk;
-    size_t counter = 0;
     std::string buffer = "";
     buffer.reserve(1024 * 30);
     while (tripleQueue.pop(tripleChunk)) {
       // Write everything
-      for (auto& t : tripleChunk) {
+      for (size_t i = 0; i < tripleChunk.size; i++) {
+        const std::string& t = tripleChunk.triples[i];
         // Deduplicate
         std::vector<std::string> val = {t};
         uint64_t rowHash = combinedHash(val);
@@ -800,20 +775,16 @@ size_t execute_with_graph(const std::string& input_file_name,
         }
         global_hashes.insert(rowHash);
         buffer += t;
-        counter++;
 
-        if (counter == 500) {
-          outputFile << buffer;
-          buffer = "";
-          counter = 0;
+        // Hand over large buffers, small writes fragment the file and the Turtle subject groups
+        if (buffer.size() >= OutputWriter::compression_block_size) {
+          output.write(buffer);
         }
       }
+      triplePool.release(std::move(tripleChunk));
     }
     // Flush any remaining content in the buffer
-    if (!buffer.empty()) {
-      outputFile << buffer;
-    }
-    outputFile.close();
+    output.write(buffer);
   });
 
   // --------------------------------------
@@ -825,6 +796,7 @@ size_t execute_with_graph(const std::string& input_file_name,
 
   tripleQueue.set_finished();
   consumer.join();
+  record_chunking_stats(chunking.stats());
 
   return triple_count.load();
 }
@@ -833,8 +805,29 @@ size_t execute_with_graph(const std::string& input_file_name,
 /// C wrapper
 //////////////////////////////////////////////////////////////////////////////////////////////////////////
 
+// Apply executor options, options of the standard executor are ignored
+void apply_options(const std::string& options) {
+  ResourceSettings resource_settings;
+  OutputSettings output_settings;
+  for (const auto& [key, value] : parse_options(options)) {
+    bool standard_executor_option = key == "join_index_dir" || key == "heuristic_ordering" || key == "sharded_output" ||
+                                   key == "concatenate_shards" || key == "result_dictionary";
+    if (!standard_executor_option && !parse_resource_option(key, value, resource_settings) &&
+        !parse_output_option(key, value, output_settings)) {
+      std::cout << "Error: Unknown executor option. Got: " << key << std::endl;
+      std::exit(1);
+    }
+  }
+  ResourceManager::instance().configure(resource_settings);
+  configure_output(output_settings);
+}
+
 extern "C" {
-size_t simple_threaded_mapping(const char* information) {
+size_t simple_threaded_mapping(const char* information, const char* options) {
+  apply_options(std::string(options));
+  // Threads started from here on run on the CPUs of the budget
+  AffinityScope affinity_scope;
+
   std::string info(information);
   std::vector<std::string> split_plans = split_by_substring(info, "PxPwPePrP");
 
@@ -876,6 +869,7 @@ size_t simple_threaded_mapping(const char* information) {
     // Write to file
     // Serialize the unique triples.
     size_t triple_number = global_hashes.size();
+    close_output_writers();
 
     return triple_number;
   } else {
@@ -909,8 +903,16 @@ size_t simple_threaded_mapping(const char* information) {
       // Otherwise execute normal
       res = execute(input_file_name, output_file_name, base_uri, projected_attributes, s_content, p_content, o_content);
     }
+    close_output_writers();
 
     return res;
   }
 }
+
+// Chunk size and queue depth chosen by the last pipeline, as key===value|||key===value
+const char* threaded_run_stats() {
+  static std::string run_stats;
+  run_stats = last_chunking_stats();
+  return run_stats.c_str();
+}
 }
@@ -0,0 +1,34 @@
+#include "triple_collector.h"
+
+#include "xxhash.h"
+
+ConcurrentFingerprintSet::ConcurrentFingerprintSet() {
+  for (auto& shard : shards_) {
+    shard = std::make_unique<Shard>();
+  }
+}
+
+bool ConcurrentFingerprintSet::insert(const std::string& triple) {
+  XXH128_hash_t hash = XXH3_128bits(triple.data(), triple.size());
+  Fingerprint fingerprint{hash.low64, hash.high64};
+
+  Shard& shard = *shards_[hash.low64 % num_shards];
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  return shard.fingerprints.insert(fingerprint).second;
+}
+
+size_t ConcurrentFingerprintSet::size() const {
+  size_t total = 0;
+  for (const auto& shard : shards_) {
+    std::lock_guard<std::mutex> lock(shard->mutex);
+    total += shard->fingerprints.size();
+  }
+  return total;
+}
+
+void TripleCollector::insert(const std::string& triple) {
+  if (fingerprints_ == nullptr || fingerprints_->insert(triple)) {
+    buffer_ += triple;
+    count_++;
+  }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// Set of 128 bit triple fingerprints shared by all plans of a dependent partition.
+// Split into shards with their own lock, so plans running concurrently rarely contend.
+class ConcurrentFingerprintSet {
+ public:
+  ConcurrentFingerprintSet();
+
+  // Returns true if the triple was not seen before.
+  bool insert(const std::string& triple);
+
+  size_t size() const;
+
+ private:
+  struct Fingerprint {
+    uint64_t low;
+    uint64_t high;
+    bool operator==(const Fingerprint& other) const { return low == other.low && high == other.high; }
+  };
+  struct FingerprintHash {
+    size_t operator()(const Fingerprint& fingerprint) const { return fingerprint.high; }
+  };
+  struct Shard {
+    mutable std::mutex mutex;
+    std::unordered_set<Fingerprint, FingerprintHash> fingerprints;
+  };
+
+  static constexpr size_t num_shards = 64;
+  std::array<std::unique_ptr<Shard>, num_shards> shards_;
+};
+
+// Set of 64 bit row hashes shared by the tasks of a scan or a join, sharded so the tasks rarely contend.
+class ConcurrentHashSet {
+ public:
+  // Returns true if the hash was not seen before.
+  bool insert(uint64_t hash) {
+    Shard& shard = shards_[hash >> 58];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    return shard.hashes.insert(hash).second;
+  }
+
+ private:
+  struct Shard {
+    std::mutex mutex;
+    std::unordered_set<uint64_t> hashes;
+  };
+  std::array<Shard, 64> shards_;
+};
+
+// Output of one plan of a dependent partition. Triples not yet generated by any plan
+// of the partition are appended to the buffer of the plan. Without a fingerprint set all
+// triples are appended, the sorted output removes the duplicates.
+class TripleCollector {
+ public:
+  explicit TripleCollector(ConcurrentFingerprintSet* fingerprints) : fingerprints_(fingerprints) {}
+
+  void insert(const std::string& triple);
+
+  size_t size() const { return count_; }
+  const std::string& buffer() const { return buffer_; }
+
+ private:
+  ConcurrentFingerprintSet* fingerprints_;
+  std::string buffer_;
+  size_t count_ = 0;
+};
@@ -0,0 +1,112 @@
+#include "turtle_output.h"
+
+#include <algorithm>
+#include <array>
+#include <iostream>
+
+#include "ntriples.h"
+
+constexpr std::string_view rdf_type = "<http://www.w3.org/1999/02/22-rdf-syntax-ns#type>";
+
+// Characters of a local name written with a backslash escape
+constexpr std::string_view escaped_local_characters = "~.-!$&'()*+,;=/?#@%";
+
+static bool is_plain_local_character(char c) {
+  return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
+
+// Local names may hold letters, digits and escaped characters, others keep the full IRI
+static bool is_local_name(std::string_view local) {
+  return std::all_of(local.begin(), local.end(), [](char c) {
+    return is_plain_local_character(c) || escaped_local_characters.find(c) != std::string_view::npos;
+  });
+}
+
+TurtleSerializer::TurtleSerializer(const std::vector<std::string>& namespaces) {
+  for (size_t i = 0; i < namespaces.size(); ++i) {
+    prefixes_.push_back({"ns" + std::to_string(i + 1), namespaces[i]});
+    header_ += "@prefix " + prefixes_.back().name + ": <" + prefixes_.back().iri + "> .\n";
+  }
+  if (!header_.empty()) {
+    header_ += "\n";
+  }
+  std::stable_sort(prefixes_.begin(), prefixes_.end(),
+                   [](const Prefix& a, const Prefix& b) { return a.iri.size() > b.iri.size(); });
+}
+
+void TurtleSerializer::append_term(std::string& turtle, std::string_view term) const {
+  if (term.front() == '<') {
+    std::string_view iri = term.substr(1, term.size() - 2);
+    for (const auto& prefix : prefixes_) {
+      if (iri.size() >= prefix.iri.size() && iri.compare(0, prefix.iri.size(), prefix.iri) == 0 &&
+          is_local_name(iri.substr(prefix.iri.size()))) {
+        turtle += prefix.name;
+        turtle += ':';
+        std::string_view local = iri.substr(prefix.iri.size());
+        for (size_t i = 0; i < local.size(); ++i) {
+          // '-' may not start a local name
+          if (!is_plain_local_character(local[i]) || (i == 0 && local[i] == '-')) {
+            turtle += '\\';
+          }
+          turtle += local[i];
+        }
+        return;
+      }
+    }
+  }
+  turtle += term;
+}
+
+void TurtleSerializer::convert(const std::string& ntriples, std::string& turtle) const {
+  std::string_view data(ntriples);
+  std::string_view subject, predicate;
+  size_t line_start = 0;
+  while (line_start < data.size()) {
+    size_t line_end = data.find('\n', line_start);
+    if (line_end == std::string_view::npos) {
+      line_end = data.size();
+    }
+    std::string_view line = data.substr(line_start, line_end - line_start);
+    line_start = line_end + 1;
+    if (line.empty()) {
+      continue;
+    }
+
+    std::array<std::string_view, 4> terms;
+    size_t count = split_ntriples_line(line, terms);
+    if (count == 0) {
+      std::cerr << "Error: Unable to serialize generated triple as Turtle. Got: " << line << std::endl;
+      std::exit(1);
+    }
+    if (count == 4) {
+      std::cerr << "Error: Turtle output does not support named graphs. Got: " << line << std::endl;
+      std::exit(1);
+    }
+
+    if (terms[0] == subject && terms[1] == predicate) {
+      turtle += " ,\n        ";
+    } else {
+      if (terms[0] == subject) {
+        turtle += " ;\n    ";
+      } else {
+        if (!subject.empty()) {
+          turtle += " .\n";
+        }
+        append_term(turtle, terms[0]);
+        turtle += ' ';
+      }
+      if (terms[1] == rdf_type) {
+        turtle += 'a';
+      } else {
+        append_term(turtle, terms[1]);
+      }
+      turtle += ' ';
+    }
+    append_term(turtle, terms[2]);
+    subject = terms[0];
+    predicate = terms[1];
+  }
+  if (!subject.empty()) {
+    turtle += " .\n";
+  }
+}
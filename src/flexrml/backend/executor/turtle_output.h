@@ -0,0 +1,30 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Serializer of the Turtle output. IRIs starting with a prefix namespace are written as
+// prefixed names, consecutive triples of a buffer with the same subject are grouped with
+// ';' and objects of the same subject and predicate with ','.
+class TurtleSerializer {
+ public:
+  // Namespaces of the @prefix declarations, named ns1, ns2, ...
+  explicit TurtleSerializer(const std::vector<std::string>& namespaces);
+
+  // The @prefix declarations starting the file
+  const std::string& header() const { return header_; }
+
+  // Appends the triples of a buffer of complete N-Triples lines as Turtle statements.
+  void convert(const std::string& ntriples, std::string& turtle) const;
+
+ private:
+  void append_term(std::string& turtle, std::string_view term) const;
+
+  struct Prefix {
+    std::string name;
+    std::string iri;
+  };
+  std::vector<Prefix> prefixes_;  // longest namespace first
+  std::string header_;
+};
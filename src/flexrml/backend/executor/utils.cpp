@@ -9,6 +9,8 @@
 #include <string_view>
 #include <unordered_set>
 
+#include "output_writer.h"
+
 std::vector<std::string> split_by_substring(const std::string& str, const std::string& delimiter) {
   std::vector<std::string> result;
   size_t start = 0;
@@ -25,6 +27,23 @@ std::vector<std::string> split_by_substring(const std::string& str, const std::s
   return result;
 }
 
+// Split executor options, given as key===value|||key===value
+std::vector<std::pair<std::string, std::string>> parse_options(const std::string& options) {
+  std::vector<std::pair<std::string, std::string>> result;
+  for (const auto& option : split_by_substring(options, "|||")) {
+    if (option.empty()) {
+      continue;
+    }
+    std::vector<std::string> key_value = split_by_substring(option, "===");
+    if (key_value.size() != 2) {
+      std::cout << "Error: Malformed executor option. Got: " << option << std::endl;
+      std::exit(1);
+    }
+    result.emplace_back(key_value[0], key_value[1]);
+  }
+  return result;
+}
+
 std::vector<std::string> split_csv_line(const std::string& str, char separator) {
   std::vector<std::string> result;
   result.reserve(64);
@@ -83,6 +102,17 @@ uint64_t combinedHash(std::vector<std::string>& fields) {
   return hash;
 }
 
+// Hash only the fields at the given indices, e.g. the columns of a composite join key.
+uint64_t combinedHash(const std::vector<std::string>& fields, const std::vector<int>& indices) {
+  uint64_t hash = 0;
+  for (int idx : indices) {
+    const std::string& field = fields[idx];
+    uint64_t fieldHash = XXH3_64bits(field.data(), field.size());
+    hash ^= fieldHash + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+  }
+  return hash;
+}
+
 std::string replace_substring(const std::string& original, const std::string& toReplace, const std::string& replacement) {
   std::string result = original;
   std::size_t pos = result.find(toReplace);
@@ -314,43 +344,35 @@ std::string create_operator(const std::string& term_map,
 void handle_constant(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
                      const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
                      const fs::path& output_file_name) {
-  std::ofstream outputFile(output_file_name, std::ios::app);
-  if (!outputFile) {
-    std::cout << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
-  std::string subject, predicate, object, graph;
+  std::string subject, predicate, object, graph, triple;
   subject = handle_term_type(s_content[2], s_content[0], "", "");
   predicate = handle_term_type(p_content[2], p_content[0], "", "");
   object = handle_term_type(o_content[2], o_content[0], o_content[3], o_content[4]);
 
   if (g_content.empty()) {
-    outputFile << subject + " " + predicate + " " + object + " .\n";
+    triple = subject + " " + predicate + " " + object + " .\n";
   } else {
     graph = handle_term_type(g_content[2], g_content[0], "", "");
-    outputFile << subject + " " + predicate + " " + object + " " + graph + " .\n";
+    triple = subject + " " + predicate + " " + object + " " + graph + " .\n";
   }
+  output_writer(output_file_name).write(triple);
 }
 
 void handle_constant_preformatted(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
                                   const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
                                   const fs::path& output_file_name) {
-  std::ofstream outputFile(output_file_name, std::ios::app);
-  if (!outputFile) {
-    std::cout << "Error: Unable to open file for writing." << std::endl;
-    std::exit(1);
-  }
-
+  std::string triple;
   if (g_content.empty()) {
-    outputFile << s_content[0] + " " + p_content[0] + " " + o_content[0] + " .\n";
+    triple = s_content[0] + " " + p_content[0] + " " + o_content[0] + " .\n";
   } else {
-    outputFile << s_content[0] + " " + p_content[0] + " " + o_content[0] + " " + g_content[0] + " .\n";
+    triple = s_content[0] + " " + p_content[0] + " " + o_content[0] + " " + g_content[0] + " .\n";
   }
+  output_writer(output_file_name).write(triple);
 }
 
-std::unordered_set<std::string> handle_constant_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
-                                                          const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
-                                                          const fs::path& output_file_name, std::unordered_set<std::string>& unique_triple) {
+void handle_constant_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
+                               const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
+                               const fs::path& output_file_name, TripleCollector& unique_triple) {
   std::string subject, predicate, object, graph;
   subject = handle_term_type(s_content[2], s_content[0], "", "");
   predicate = handle_term_type(p_content[2], p_content[0], "", "");
@@ -359,26 +381,22 @@ std::unordered_set<std::string> handle_constant_dependent(const std::vector<std:
   if (g_content.empty()) {
     std::string res = subject + " " + predicate + " " + object + " .\n";
     unique_triple.insert(res);
-    return unique_triple;
   } else {
     graph = handle_term_type(g_content[2], g_content[0], "", "");
 
     std::string res = subject + " " + predicate + " " + object + " " + graph + " .\n";
     unique_triple.insert(res);
-    return unique_triple;
   }
 }
 
-std::unordered_set<std::string> handle_constant_preformatted_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
-                                                                       const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
-                                                                       const fs::path& output_file_name, std::unordered_set<std::string>& unique_triple) {
+void handle_constant_preformatted_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
+                                            const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
+                                            const fs::path& output_file_name, TripleCollector& unique_triple) {
   if (g_content.empty()) {
     std::string res = s_content[0] + " " + p_content[0] + " " + o_content[0] + " .\n";
     unique_triple.insert(res);
-    return unique_triple;
   } else {
     std::string res = s_content[0] + " " + p_content[0] + " " + o_content[0] + " " + g_content[0] + " .\n";
     unique_triple.insert(res);
-    return unique_triple;
   }
 }
\ No newline at end of file
@@ -4,23 +4,32 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <utility>
 #include <vector>
 
 #include "definitions.h"
+#include "triple_collector.h"
 #include "xxhash.h"
 
 namespace fs = std::filesystem;
 
 std::vector<std::string> split_by_substring(const std::string& str, const std::string& delimiter);
 
+std::vector<std::pair<std::string, std::string>> parse_options(const std::string& options);
+
 std::string replace_substring(const std::string& original, const std::string& toReplace, const std::string& replacement);
 
 uint64_t combinedHash(std::vector<std::string>& fields);
 
+uint64_t combinedHash(const std::vector<std::string>& fields, const std::vector<int>& indices);
+
 int get_index(const std::vector<std::string>& input_vector, std::string searched_element);
 
 std::vector<std::string> split_csv_line(const std::string& str, char separator);
 
+// Attribute names referenced in a template, e.g. {id}
+std::vector<std::string> extract_substrings(const std::string& str);
+
 void handle_constant(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
                      const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
                      const fs::path& output_file_name);
@@ -29,13 +38,13 @@ void handle_constant_preformatted(const std::vector<std::string>& s_content, con
                                   const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
                                   const fs::path& output_file_name);
 
-std::unordered_set<std::string> handle_constant_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
-                                                          const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
-                                                          const fs::path& output_file_name, std::unordered_set<std::string>& unique_triple);
+void handle_constant_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
+                               const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
+                               const fs::path& output_file_name, TripleCollector& unique_triple);
 
-std::unordered_set<std::string> handle_constant_preformatted_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
-                                                                       const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
-                                                                       const fs::path& output_file_name, std::unordered_set<std::string>& unique_triple);
+void handle_constant_preformatted_dependent(const std::vector<std::string>& s_content, const std::vector<std::string>& p_content,
+                                            const std::vector<std::string>& o_content, const std::vector<std::string>& g_content,
+                                            const fs::path& output_file_name, TripleCollector& unique_triple);
 
 std::string create_operator(const std::string& term_map,
                             const std::string& term_map_type,
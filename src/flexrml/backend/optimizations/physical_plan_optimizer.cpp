@@ -0,0 +1,182 @@
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+// used to store string result
+static std::string g_result_str;
+
+// Physical plans are lists of lines, each line is a list of elements separated by "|||".
+using PhysicalPlan = std::vector<std::vector<std::string>>;
+
+std::vector<std::string> split_by_substring(const std::string& str, const std::string& delimiter) {
+  std::vector<std::string> result;
+  size_t start = 0;
+  size_t end = str.find(delimiter);
+
+  while (end != std::string::npos) {
+    result.push_back(str.substr(start, end - start));
+    start = end + delimiter.length();
+    end = str.find(delimiter, start);
+  }
+
+  result.push_back(str.substr(start));
+
+  return result;
+}
+
+PhysicalPlan parse_plan(const std::string& plan_str) {
+  PhysicalPlan plan;
+  std::vector<std::string> lines = split_by_substring(plan_str, "\n");
+  // Plans are terminated by a newline
+  if (!lines.empty() && lines.back().empty()) {
+    lines.pop_back();
+  }
+  for (const auto& line : lines) {
+    plan.push_back(split_by_substring(line, "|||"));
+  }
+  return plan;
+}
+
+std::string plan_to_string(const PhysicalPlan& plan) {
+  std::string plan_str;
+  for (const auto& line : plan) {
+    for (size_t i = 0; i < line.size(); ++i) {
+      if (i > 0) {
+        plan_str += "|||";
+      }
+      plan_str += line[i];
+    }
+    plan_str += "\n";
+  }
+  return plan_str;
+}
+
+// Removes the relation prefix ("parent_"/"child_") of all attributes referenced in a term.
+std::string strip_relation_prefixes(const std::string& content_str) {
+  std::vector<std::string> content = split_by_substring(content_str, "===");
+  if (content.size() < 2) {
+    return content_str;
+  }
+
+  const std::vector<std::string> relations = {"parent_", "child_"};
+  if (content[1] == "template") {
+    for (const auto& relation : relations) {
+      std::string prefixed = "{" + relation;
+      size_t pos = content[0].find(prefixed);
+      while (pos != std::string::npos) {
+        content[0].erase(pos + 1, relation.size());
+        pos = content[0].find(prefixed, pos + 1);
+      }
+    }
+  } else if (content[1] == "reference") {
+    for (const auto& relation : relations) {
+      if (content[0].rfind(relation, 0) == 0) {
+        content[0] = content[0].substr(relation.size());
+        break;
+      }
+    }
+  }
+
+  std::string result = content[0];
+  for (size_t i = 1; i < content.size(); ++i) {
+    result += "===" + content[i];
+  }
+  return result;
+}
+
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+/////// Self join elimination
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+// True if the join matches every row of a source with itself: both sides read the same source,
+// all conditions compare a column with itself and the right side only projects join columns.
+// The join then returns the left input unchanged.
+bool is_identity_self_join(const PhysicalPlan& plan) {
+  std::unordered_set<std::string> join_columns;
+  for (size_t i = 1; i < plan[2].size(); ++i) {
+    std::vector<std::string> condition = split_by_substring(plan[2][i], "===");
+    if (condition.size() != 2) {
+      return false;
+    }
+    std::string left_attr = condition[0].substr(condition[0].find('_') + 1);
+    std::string right_attr = condition[1].substr(condition[1].find('_') + 1);
+    if (left_attr != right_attr) {
+      return false;
+    }
+    join_columns.insert(left_attr);
+  }
+
+  for (const auto& attr : split_by_substring(plan[1][2], "===")) {
+    if (join_columns.count(attr) == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+PhysicalPlan optimize_self_join(const PhysicalPlan& plan) {
+  // Must be a join over a single source
+  if (plan.size() != 7 || plan[0].size() < 3 || plan[1].size() < 3 || plan[0][1] != plan[1][1]) {
+    return plan;
+  }
+
+  const std::string& join_operator = plan[2][0];
+  if (join_operator != "hash_join" && join_operator != "semi_join") {
+    return plan;
+  }
+
+  if (is_identity_self_join(plan)) {
+    // Replace the join by a scan of the source
+    PhysicalPlan new_plan;
+    new_plan.push_back({"seq_scan", plan[0][1], plan[0][2]});
+
+    std::vector<std::string> new_format = {"format"};
+    for (size_t i = 1; i < plan[3].size(); ++i) {
+      new_format.push_back(strip_relation_prefixes(plan[3][i]));
+    }
+    new_plan.push_back(new_format);
+
+    new_plan.push_back(plan[4]);
+    new_plan.push_back(plan[5]);
+    new_plan.push_back(plan[6]);
+    return new_plan;
+  }
+
+  // Otherwise read the source once for both sides of the join. The executor keeps a hash join
+  // if the buffered probe rows would not fit into memory.
+  if (join_operator == "hash_join") {
+    PhysicalPlan new_plan = plan;
+    new_plan[2][0] = "self_join";
+    return new_plan;
+  }
+
+  return plan;
+}
+
+extern "C" {
+// Rewrites physical plans, returns the same number of plans in the same order
+const char* optimize_physical_plans(const char* physical_plans_char) {
+  std::string physical_plans_str(physical_plans_char);
+  std::vector<std::string> physical_plans = split_by_substring(physical_plans_str, "PxPwPePrP");
+
+  g_result_str = "";
+
+  for (size_t i = 0; i < physical_plans.size(); ++i) {
+    PhysicalPlan plan = parse_plan(physical_plans[i]);
+    if (plan.size() != 5 && plan.size() != 7) {
+      std::cout << "Unsupported plan size in plan optimizer. Got: " << plan.size() << std::endl;
+      std::exit(1);
+    }
+
+    plan = optimize_self_join(plan);
+
+    if (i > 0) {
+      g_result_str += "PxPwPePrP";
+    }
+    g_result_str += plan_to_string(plan);
+  }
+
+  return g_result_str.c_str();
+}
+}
@@ -120,6 +120,16 @@ std::string get_invar(const std::vector<std::string>& content) {
   return invariant;
 }
 
+// Namespace of an IRI invariant for a Turtle prefix, the invariant up to its last '/' or '#'.
+// Returns an empty string if the invariant has no usable namespace.
+std::string get_namespace(const std::string& invariant) {
+  if (invariant.find("://") == std::string::npos || invariant.find_first_of(" <>\"{}") != std::string::npos) {
+    return "";
+  }
+  size_t index = invariant.find_last_of("/#");
+  return invariant.substr(0, index + 1);
+}
+
 // Partitions the data and returns a mapping string of id and partition_id.
 std::string create_partitions(std::vector<DfEntry> invar_data) {
   // Partitioning subject: sort by S_invar.
@@ -254,4 +264,42 @@ const char* ra_partitioner(const char* ra_expressions_char) {
 
   return g_result_str.c_str();
 }
+
+// Returns the namespaces of the IRI term maps, one per line, used as Turtle prefixes.
+// Namespaces are derived from the template invariants the partitions are built from.
+const char* template_namespaces(const char* ra_expressions_char) {
+  std::string ra_expressions_str(ra_expressions_char);
+  std::set<std::string> namespaces;
+
+  for (const auto& ra_expression : split_by_substring(ra_expressions_str, "\n")) {
+    std::vector<std::string> ra_expression_split = split_by_substring(ra_expression, "|||");
+    if (ra_expression_split.size() != 3) {
+      continue;
+    }
+    std::vector<std::string> s_content = split_by_substring(ra_expression_split[0], "===");
+    std::vector<std::string> p_content = split_by_substring(ra_expression_split[1], "===");
+    std::vector<std::string> o_content = split_by_substring(ra_expression_split[2], "===");
+
+    // Predicates are always IRIs
+    std::vector<std::string> iri_invariants = {get_invar(p_content)};
+    if (s_content[2] == "iri") {
+      iri_invariants.push_back(get_invar(s_content));
+    }
+    if (o_content.size() > 2 && o_content[2] == "iri") {
+      iri_invariants.push_back(get_invar(o_content));
+    }
+    for (const auto& invariant : iri_invariants) {
+      std::string iri_namespace = get_namespace(invariant);
+      if (!iri_namespace.empty()) {
+        namespaces.insert(iri_namespace);
+      }
+    }
+  }
+
+  g_result_str = "";
+  for (const auto& iri_namespace : namespaces) {
+    g_result_str += iri_namespace + "\n";
+  }
+  return g_result_str.c_str();
+}
 }
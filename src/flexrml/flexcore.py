@@ -32,6 +32,29 @@ class Configuration:
         self.threading_enabled = "true"
         self.materialize_constants = "true"
         self.heuristic_ordering = "true"
+        self.join_elimination = "true"
+        self.referential_integrity = "false"
+        self.join_index_dir = ""
+        self.threads = "0"
+        self.cpu_affinity = ""
+        self.numa_node = ""
+        self.sharded_output = "false"
+        self.concatenate_shards = "false"
+        self.output_format = "nt"
+        self.compression = ""
+        self.compression_level = "0"
+        self.output_cache = "keep"
+        self.preallocate_output = "false"
+        self.sorted_output = "false"
+        self.sort_dedup = "false"
+        self.sort_memory = ""
+        self.sort_directory = ""
+        self.result_dictionary = "false"
+        self.result_iterator = "false"
+        self.rotate_bytes = ""
+        self.rotate_triples = ""
+        self.route_graphs = "false"
+        self.graph_sinks = ""
         self.generate_plan = True
         self.data = None
 
@@ -268,7 +291,19 @@ def run_mapping(mapping_config):
             print(f"{ra_str}<==>{ra_expressions_iterators}")
         else:
             triple = run_converter(ra_str, mapping_config.output_file_path, mapping_config.base_uri, mapping_config.continue_on_error, mapping_config.threading_enabled, 
-                        mapping_config.materialize_constants, mapping_config.heuristic_ordering, mapping_config.return_triple, mapping_config.data, ra_expressions_iterators)
+                        mapping_config.materialize_constants, mapping_config.heuristic_ordering, mapping_config.return_triple, mapping_config.data, ra_expressions_iterators,
+                        join_elimination=mapping_config.join_elimination, referential_integrity=mapping_config.referential_integrity,
+                        join_index_dir=mapping_config.join_index_dir, threads=mapping_config.threads,
+                        cpu_affinity=mapping_config.cpu_affinity, numa_node=mapping_config.numa_node,
+                        sharded_output=mapping_config.sharded_output, concatenate_shards=mapping_config.concatenate_shards,
+                        compression=mapping_config.compression, compression_level=mapping_config.compression_level,
+                        output_format=mapping_config.output_format, output_cache=mapping_config.output_cache,
+                        preallocate_output=mapping_config.preallocate_output,
+                        sorted_output=mapping_config.sorted_output, sort_dedup=mapping_config.sort_dedup,
+                        sort_memory=mapping_config.sort_memory, sort_directory=mapping_config.sort_directory,
+                        result_dictionary=mapping_config.result_dictionary, result_iterator=mapping_config.result_iterator,
+                        rotate_bytes=mapping_config.rotate_bytes, rotate_triples=mapping_config.rotate_triples,
+                        route_graphs=mapping_config.route_graphs, graph_sinks=mapping_config.graph_sinks)
             
             return triple
     else:
@@ -278,12 +313,27 @@ def run_mapping(mapping_config):
         ra_expressions_iterators = mapping_config.plan.split("<==>")[1]
         ra_expressions_iterators = ast.literal_eval(ra_expressions_iterators)
         triple = run_converter(ra_str, mapping_config.output_file_path, mapping_config.base_uri, mapping_config.continue_on_error, mapping_config.threading_enabled, 
-                        mapping_config.materialize_constants, mapping_config.heuristic_ordering, mapping_config.return_triple, mapping_config.data, ra_expressions_iterators)
+                        mapping_config.materialize_constants, mapping_config.heuristic_ordering, mapping_config.return_triple, mapping_config.data, ra_expressions_iterators,
+                        join_elimination=mapping_config.join_elimination, referential_integrity=mapping_config.referential_integrity,
+                        join_index_dir=mapping_config.join_index_dir, threads=mapping_config.threads,
+                        cpu_affinity=mapping_config.cpu_affinity, numa_node=mapping_config.numa_node,
+                        sharded_output=mapping_config.sharded_output, concatenate_shards=mapping_config.concatenate_shards,
+                        compression=mapping_config.compression, compression_level=mapping_config.compression_level,
+                        output_format=mapping_config.output_format, output_cache=mapping_config.output_cache,
+                        preallocate_output=mapping_config.preallocate_output,
+                        sorted_output=mapping_config.sorted_output, sort_dedup=mapping_config.sort_dedup,
+                        sort_memory=mapping_config.sort_memory, sort_directory=mapping_config.sort_directory,
+                        result_dictionary=mapping_config.result_dictionary, result_iterator=mapping_config.result_iterator,
+                        rotate_bytes=mapping_config.rotate_bytes, rotate_triples=mapping_config.rotate_triples,
+                        route_graphs=mapping_config.route_graphs, graph_sinks=mapping_config.graph_sinks)
         return triple
 
 ####################################################################################################################
 # Function to use as library
-def execute(mapping_source = None, plan = None, base_uri = BASE_URI, generate_plan = False, use_threading = True, data = {}):
+# With as_iterator the triples are returned as an iterator of N-Triples lines, read from the
+# executor as they are consumed. term_dictionary stores the triples with a term dictionary.
+def execute(mapping_source = None, plan = None, base_uri = BASE_URI, generate_plan = False, use_threading = True, data = {},
+            as_iterator = False, term_dictionary = False):
     config = Configuration()
 
     if mapping_source:
@@ -297,6 +347,8 @@ def execute(mapping_source = None, plan = None, base_uri = BASE_URI, generate_pl
     config.base_uri = base_uri
     config.threading_enabled = str(use_threading).lower()
     config.data = data
+    config.result_iterator = str(as_iterator).lower()
+    config.result_dictionary = str(term_dictionary).lower()
 
     triple = run_mapping(config)
 
@@ -319,6 +371,27 @@ def main():
     parser.add_argument("--no-threading", action='store_false', help="Disables multithreading during execution.")
     parser.add_argument("--no-const-folding", action='store_false', help="Disables constant folding optimization.")
     parser.add_argument("--no-ordering", action='store_false', help="Disables heuristic ordering optimization.")
+    parser.add_argument("--no-join-elimination", action='store_false', help="Disables elimination of joins whose object is derivable from the join key.")
+    parser.add_argument("--assume-referential-integrity", action='store_true', help="Assume every join key has a match, eliminated joins skip the existence check.")
+    parser.add_argument("--join-index-dir", type=str, required=False, help="Directory where join indices are persisted and reused across runs.")
+    parser.add_argument("--threads", type=int, required=False, help="Maximum number of worker threads. Defaults to one per available CPU.")
+    parser.add_argument("--cpu-affinity", type=str, required=False, help="Restrict worker threads to a CPU list, e.g. 0-7,16.")
+    parser.add_argument("--numa-node", type=int, required=False, help="Restrict worker threads to the CPUs of a NUMA node.")
+    parser.add_argument("--sharded-output", action='store_true', help="Write each partition into its own output file (out.part-00000.nt) with a manifest.")
+    parser.add_argument("--concatenate-shards", action='store_true', help="Concatenate the sharded output files into the output file at the end.")
+    parser.add_argument("--output-format", type=str, choices=["nt", "ttl", "hdt"], required=False, help="Format of the output file: N-Triples, Turtle or binary dictionary encoded HDT-style triples. Defaults to ttl for .ttl and hdt for .hdt output files.")
+    parser.add_argument("--compression", type=str, choices=["none", "gzip", "zstd"], required=False, help="Compress the output in parallel. Defaults to gzip for .gz and zstd for .zst output files.")
+    parser.add_argument("--output-cache", type=str, choices=["keep", "drop", "direct"], required=False, help="Page cache use of the output: keep it, drop written pages, or bypass the cache with O_DIRECT.")
+    parser.add_argument("--preallocate-output", action='store_true', help="Preallocate the estimated output size with fallocate.")
+    parser.add_argument("--compression-level", type=int, required=False, help="Compression level of the output, defaults to the level of the codec.")
+    parser.add_argument("--sorted-output", action='store_true', help="Sort the output by subject with an external sort.")
+    parser.add_argument("--sort-dedup", action='store_true', help="Remove duplicate triples while merging the sorted output, partitions skip their own deduplication.")
+    parser.add_argument("--sort-memory", type=int, required=False, help="Memory in MiB of a sorted run before it is spilled to disk. Defaults to 1024.")
+    parser.add_argument("--sort-dir", type=str, required=False, help="Directory of the spilled sort runs. Defaults to the directory of the output file.")
+    parser.add_argument("--rotate-size", type=str, required=False, help="Continue in the next output file (out.0.nt, out.1.nt, ...) after about this size on disk, e.g. 1G. Files end at triple boundaries.")
+    parser.add_argument("--rotate-triples", type=int, required=False, help="Continue in the next output file after this many triples.")
+    parser.add_argument("--route-graphs", action='store_true', help="Write the triples of every named graph into their own file (out-<graph>-<hash>.nt) with a manifest, the default graph into the output file.")
+    parser.add_argument("--graph-sinks", type=int, required=False, help="Graph files kept open at once with --route-graphs. Defaults to 64. Sorted, rotated and hdt graph files stay open, the output may have at most this many named graphs.")
 
     args = parser.parse_args()
 
@@ -358,6 +431,77 @@ def main():
     if args.no_ordering == False:
         config.heuristic_ordering = str(args.no_ordering).lower()
 
+    if args.no_join_elimination == False:
+        config.join_elimination = str(args.no_join_elimination).lower()
+
+    if args.assume_referential_integrity:
+        config.referential_integrity = str(args.assume_referential_integrity).lower()
+
+    if args.join_index_dir:
+        config.join_index_dir = args.join_index_dir
+
+    if args.threads is not None:
+        config.threads = str(args.threads)
+
+    if args.cpu_affinity:
+        config.cpu_affinity = args.cpu_affinity
+
+    if args.numa_node is not None:
+        config.numa_node = str(args.numa_node)
+
+    if args.sharded_output or args.concatenate_shards:
+        config.sharded_output = "true"
+
+    if args.concatenate_shards:
+        config.concatenate_shards = "true"
+
+    if args.output_format:
+        config.output_format = args.output_format
+    elif config.output_file_path.endswith(".ttl"):
+        config.output_format = "ttl"
+    elif config.output_file_path.endswith(".hdt"):
+        config.output_format = "hdt"
+
+    if args.compression:
+        config.compression = args.compression
+    elif config.output_file_path.endswith(".gz"):
+        config.compression = "gzip"
+    elif config.output_file_path.endswith(".zst"):
+        config.compression = "zstd"
+
+    if args.output_cache:
+        config.output_cache = args.output_cache
+
+    if args.preallocate_output:
+        config.preallocate_output = "true"
+
+    if args.compression_level is not None:
+        config.compression_level = str(args.compression_level)
+
+    if args.sorted_output or args.sort_dedup:
+        config.sorted_output = "true"
+
+    if args.sort_dedup:
+        config.sort_dedup = "true"
+
+    if args.sort_memory is not None:
+        config.sort_memory = str(args.sort_memory)
+
+    if args.sort_dir:
+        config.sort_directory = args.sort_dir
+
+    if args.rotate_size:
+        config.rotate_bytes = args.rotate_size
+
+    if args.rotate_triples is not None:
+        config.rotate_triples = str(args.rotate_triples)
+
+    if args.route_graphs:
+        config.route_graphs = "true"
+
+    if args.graph_sinks is not None:
+        config.graph_sinks = str(args.graph_sinks)
+
     if args.generate_plan == False:
         config.generate_plan = False
 
@@ -43,7 +43,7 @@ struct Object {
   std::string lang_tag = "None";
   std::string data_type = "None";
   std::string join_type = "None";
-  std::array<std::string, 2> join_condition = {"", ""};
+  std::vector<std::array<std::string, 2>> join_conditions;  // {child, parent} per joinCondition
 };
 
 struct Graph {
@@ -609,22 +609,21 @@ std::tuple<Object, std::string> get_object_w_join(
 
   std::vector<std::string> join_condition_nodes = find_matching_objects(
       triples, object_node, "http://w3id.org/rml/joinCondition");
-  std::string join_condition_node = "";
-  if (join_condition_nodes.size() == 1) {
-    join_condition_node = join_condition_nodes[0];
+  if (!join_condition_nodes.empty()) {
     result.join_type = "equi-join";
 
-    // Get Join conditions
-    std::vector<std::string> child_arr = find_matching_objects(
-        triples, join_condition_node, "http://w3id.org/rml/child");
-    std::string child = child_arr[0];
+    // Get Join conditions, multiple conditions form a composite key
+    for (const auto &join_condition_node : join_condition_nodes) {
+      std::vector<std::string> child_arr = find_matching_objects(
+          triples, join_condition_node, "http://w3id.org/rml/child");
+      std::string child = child_arr[0];
 
-    std::vector<std::string> parent_arr = find_matching_objects(
-        triples, join_condition_node, "http://w3id.org/rml/parent");
-    std::string parent = parent_arr[0];
+      std::vector<std::string> parent_arr = find_matching_objects(
+          triples, join_condition_node, "http://w3id.org/rml/parent");
+      std::string parent = parent_arr[0];
 
-    result.join_condition[0] = child;
-    result.join_condition[1] = parent;
+      result.join_conditions.push_back({child, parent});
+    }
   }
 
   // Get parentTM
@@ -716,16 +715,14 @@ std::vector<std::string> get_projected_attributes(const Subject &subj,
     }
   }
 
-  // Handle join condition if available
-  bool is_empty = std::all_of(obj.join_condition.begin(), obj.join_condition.end(), [](const std::string &s) { return s.empty(); });
+  // Handle join conditions if available
   // if object is empty -> generation of child join; else geneartion of parent
   // join
-
-  if (!is_empty) {
+  for (const auto &join_condition : obj.join_conditions) {
     if (obj.term_map_type.empty()) {
-      unique_attributes.insert(obj.join_condition[0]);
+      unique_attributes.insert(join_condition[0]);
     } else {
-      unique_attributes.insert(obj.join_condition[1]);
+      unique_attributes.insert(join_condition[1]);
     }
   }
 
@@ -780,7 +777,7 @@ std::string create_complex_tree(const std::vector<NTriple> &triples) {
 
   // Get projected attributes of input 1
   Object empty_obj;
-  empty_obj.join_condition = obj.join_condition;  // copy join condition for projection
+  empty_obj.join_conditions = obj.join_conditions;  // copy join conditions for projection
   std::vector<std::string> proj_attributes1 = get_projected_attributes(subj, pred, empty_obj);
 
   // Get projected attributeds of input 2
@@ -825,7 +822,15 @@ std::string create_complex_tree(const std::vector<NTriple> &triples) {
   if (obj.join_type == "natural-join") {
     join_node = "(" + projection_file1_node + ") bowtie (" + projection_file2_node + ")";
   } else {
-    join_node = "(" + projection_file1_node + ") bowtie [" + sources[0] + "_" + obj.join_condition[0] + "=" + parent_source + "_" + obj.join_condition[1] + "] (" + projection_file2_node + ")";
+    // Composite keys are listed comma separated: [A1=B1,A2=B2]
+    std::string join_arguments = "";
+    for (size_t i = 0; i < obj.join_conditions.size(); ++i) {
+      join_arguments += sources[0] + "_" + obj.join_conditions[i][0] + "=" + parent_source + "_" + obj.join_conditions[i][1];
+      if (i < obj.join_conditions.size() - 1) {
+        join_arguments += ",";
+      }
+    }
+    join_node = "(" + projection_file1_node + ") bowtie [" + join_arguments + "] (" + projection_file2_node + ")";
   }
 
   //////////////////////////////////////